@@ -2,17 +2,23 @@
 
 #include <QHBoxLayout>
 #include <QSplitter>
-#include <QTextStream>
 #include <QMessageBox>
 #include <QInputDialog>
 #include <QAction>
 #include <QMenu>
+#include <QFileInfo>
 #include <QDebug>
 
 #include "CodeEditor.hxx"
 
 BrowseSourceWidget::BrowseSourceWidget(QWidget* p_parent):
-  QWidget(p_parent) {
+  QWidget(p_parent),
+  m_fileLoader(new FileLoader(this)),
+  m_pendingSourceAbsoluteFilePath(),
+  m_pendingLineNumber(0),
+  m_noteSaver(new NoteSaver(this)),
+  m_notesWithSaveError(),
+  m_notesLoader(new FileLoader(this)) {
 
   // Sources and open files
   m_sourcesAndOpenFilesWidget = new SourcesAndOpenFiles(this);
@@ -35,6 +41,11 @@ BrowseSourceWidget::BrowseSourceWidget(QWidget* p_parent):
   connect(m_sourcesAndOpenFilesWidget, SIGNAL(openSourceCodeFromSearchRequested(QModelIndex)), this, SLOT(openSourceCodeFromSearch(QModelIndex)));
   connect(m_sourcesAndOpenFilesWidget, SIGNAL(openSourceCodeFromOpenDocumentsRequested(QModelIndex)), this, SLOT(openSourceCodeFromOpenDocuments(QModelIndex)));
   connect(m_sourcesAndOpenFilesWidget, SIGNAL(openSourceCodeFromContextualMenuRequested(QModelIndex)), this, SLOT(openSourceCodeFromContextualMenu(QModelIndex)));
+  connect(m_sourcesAndOpenFilesWidget, SIGNAL(openSourceCodeFromGrepRequested(QModelIndex)), this, SLOT(openSourceCodeFromGrep(QModelIndex)));
+  connect(m_fileLoader, SIGNAL(fileLoaded(QString,QString,bool,QString)), this, SLOT(openLoadedSourceCode(QString,QString,bool,QString)));
+  connect(m_noteSaver, SIGNAL(saveDue(QStringList)), this, SLOT(autosaveNotes(QStringList)));
+  connect(m_noteSaver, SIGNAL(notesSaved(QString,bool,QString)), this, SLOT(updateSavedNotes(QString,bool,QString)));
+  connect(m_notesLoader, SIGNAL(fileLoaded(QString,QString,bool,QString)), this, SLOT(openLoadedNotes(QString,QString,bool,QString)));
 
   // Main part
   QSplitter* hsplitter = new QSplitter;
@@ -168,6 +179,11 @@ NoteRichTextEdit* BrowseSourceWidget::getNotesTextEditFromPosition(int p_positio
 /// PUBLIC SLOTS
 
 void BrowseSourceWidget::saveNotesFromSourceAndCloseEditor() {
+  // Notes never shown have no editor
+  if (m_browseFileInfo.getNotesPositionInStack(m_browseFileInfo.getCurrentNotesAbsoluteFilePath()) < 0) {
+    return;
+  }
+
   saveNotesFromSource();
   NoteRichTextEdit* currentNoteRichTextEdit = getNotesTextEditFromPosition();
   currentNoteRichTextEdit->editOff();
@@ -192,29 +208,25 @@ void BrowseSourceWidget::saveNotesFromSource(QStringList const& p_absoluteFilePa
 
 void BrowseSourceWidget::saveNotesFromSource(QString const& p_absoluteFilePath) {
   QString notesAbsoluteFilePath = m_browseFileInfo.getNotesAbsolutePathFromOpenDocumentAbsolutePath(p_absoluteFilePath);
-  QFile noteFile(notesAbsoluteFilePath);
-  if (!noteFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-    QMessageBox::warning(this, "Writting issue", noteFile.errorString());
-  }
-
-  QTextStream in(&noteFile);
-
   int position = m_browseFileInfo.getNotesPositionInStack(notesAbsoluteFilePath);
-  in << getNotesTextEditFromPosition(position)->toHtml();
-
-  noteFile.close();
+  if (position < 0) {
+    return;
+  }
 
-  updateSaveStateToNotes(false, p_absoluteFilePath);
+  // Only the snapshot is taken here, the notes are marked saved once written
+  m_noteSaver->save(p_absoluteFilePath, notesAbsoluteFilePath, getNotesTextEditFromPosition(position)->toHtml());
 }
 
 void BrowseSourceWidget::showHorizontal() {
   m_sourcesNotesSplitter->setOrientation(Qt::Horizontal);
   m_noteRichTextEditStackWidget->show();
+  showCurrentNotes();
 }
 
 void BrowseSourceWidget::showVertical() {
   m_sourcesNotesSplitter->setOrientation(Qt::Vertical);
   m_noteRichTextEditStackWidget->show();
+  showCurrentNotes();
 }
 
 void BrowseSourceWidget::hideNotesTextEdit() {
@@ -246,10 +258,14 @@ void BrowseSourceWidget::closeNotesAndSource(QString const& p_absoluteFilePath)
     }
   }
 
-  // Remove Notes
+  // Remove Notes, a snapshot just taken is still written
+  m_noteSaver->forget(absoluteFilePath);
+  m_notesWithSaveError.remove(absoluteFilePath);
   int currentNotesPosition = m_browseFileInfo.getNotesPositionInStack(notesAbsoluteFilePath);
-  m_noteRichTextEditStackWidget->removeWidget(m_noteRichTextEditStackWidget->widget(currentNotesPosition));
-  m_browseFileInfo.removeNotesAt(currentNotesPosition);
+  if (currentNotesPosition > -1) {
+    m_noteRichTextEditStackWidget->removeWidget(m_noteRichTextEditStackWidget->widget(currentNotesPosition));
+    m_browseFileInfo.removeNotesAt(currentNotesPosition);
+  }
 
   // Remove Source
   m_sourceCodeEditorWidget->clear();
@@ -293,7 +309,9 @@ void BrowseSourceWidget::closeAllNotesAndSource() {
     }
   }
 
-  // Remove Notes
+  // Remove Notes, snapshots just taken are still written
+  m_noteSaver->forgetAll();
+  m_notesWithSaveError.clear();
   QWidget* currentWidget = nullptr;
   while ((currentWidget = m_noteRichTextEditStackWidget->widget(0)) != nullptr) {
     m_noteRichTextEditStackWidget->removeWidget(currentWidget);
@@ -383,6 +401,24 @@ void BrowseSourceWidget::openSourceCodeFromContextualMenu(const QModelIndex& p_i
   requestUpdateFileAction();
 }
 
+void BrowseSourceWidget::openSourceCodeFromGrep(QModelIndex const& p_index) {
+  QString fileName = p_index.data(GrepResultsModel::FileNameRole).toString();
+  QString absoluteFilePath = p_index.data(Qt::ToolTipRole).toString();
+  openSourceCodeAtLine(fileName, absoluteFilePath, p_index.data(GrepResultsModel::LineNumberRole).toInt());
+}
+
+void BrowseSourceWidget::openSymbolDefinition(QString const& p_symbol) {
+  // Symbols not indexed yet, or not defined in the tree, fall back to the file name menu
+  QString absoluteFilePath;
+  int lineNumber = 0;
+  if (!m_sourcesAndOpenFilesWidget->findSymbolDefinition(p_symbol, absoluteFilePath, lineNumber)) {
+    m_sourcesAndOpenFilesWidget->openSourceCodeFromFileName(p_symbol);
+    return;
+  }
+
+  openSourceCodeAtLine(QFileInfo(absoluteFilePath).fileName(), absoluteFilePath, lineNumber);
+}
+
 void BrowseSourceWidget::updateSaveStateToNotes(bool p_value, QString const& p_absoluteFilePath) {
   QString absoluteFilePath = p_absoluteFilePath;
   QString notesAbsoluteFilePath;
@@ -411,49 +447,128 @@ void BrowseSourceWidget::requestUpdateFileAction() {
 }
 
 
-/// PRIVATE
+void BrowseSourceWidget::openLoadedSourceCode(QString const& p_absoluteFilePath, QString const& p_content, bool p_succeeded, QString const& p_errorString) {
+  // Another file may have been opened meanwhile
+  if (p_absoluteFilePath != m_pendingSourceAbsoluteFilePath) {
+    return;
+  }
+  m_pendingSourceAbsoluteFilePath.clear();
 
-QString BrowseSourceWidget::getFileContent(QString const& p_absoluteFilePath) {
-  QFile sourceFile(p_absoluteFilePath);
-  if (!sourceFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-    QMessageBox::warning(this, "Opening issue", sourceFile.errorString());
+  if (!p_succeeded) {
+    QMessageBox::warning(this, "Opening issue", p_errorString);
   }
+  m_sourceCodeEditorWidget->openSourceCode(p_content, FileTypes::fileType(p_absoluteFilePath), p_absoluteFilePath);
+  goToLineNumber(m_pendingLineNumber);
+}
 
-  QTextStream in(&sourceFile);
+void BrowseSourceWidget::scheduleNotesAutosave(bool p_modified) {
+  // Notes are edited in the stack page of the current document only
+  if (p_modified) {
+    m_noteSaver->markModified(m_browseFileInfo.getCurrentOpenDocumentAbsoluteFilePath());
+  }
+}
 
-  QString content;
-  while(!in.atEnd()) {
-    content.append(in.readLine());
-    content.append("\n");
+void BrowseSourceWidget::autosaveNotes(QStringList const& p_absoluteFilePaths) {
+  for (QString const& absoluteFilePath: p_absoluteFilePaths) {
+    saveNotesFromSource(absoluteFilePath);
   }
+}
 
-  sourceFile.close();
+void BrowseSourceWidget::updateSavedNotes(QString const& p_absoluteFilePath, bool p_succeeded, QString const& p_errorString) {
+  if (!p_succeeded) {
+    // Autosaves fail again until the cause is gone, the user is told once
+    if (!m_notesWithSaveError.contains(p_absoluteFilePath)) {
+      m_notesWithSaveError.insert(p_absoluteFilePath);
+      QMessageBox::warning(this, "Writting issue", p_errorString);
+    }
+    return;
+  }
 
-  return content;
+  m_notesWithSaveError.remove(p_absoluteFilePath);
+  updateSaveStateToNotes(false, p_absoluteFilePath);
 }
 
-void BrowseSourceWidget::openDocumentInEditor(QString const& p_fileName, QString const& p_absoluteFilePath) {
+void BrowseSourceWidget::openLoadedNotes(QString const& p_notesAbsoluteFilePath, QString const& p_content, bool p_succeeded, QString const& p_errorString) {
+  // Notes closed meanwhile, or read already
+  int position = m_browseFileInfo.getNotesPositionInStack(p_notesAbsoluteFilePath);
+  if (position < 0 || getNotesTextEditFromPosition(position)->isEnabled()) {
+    return;
+  }
+
+  // Notes not written yet are empty
+  if (!p_succeeded && QFileInfo::exists(p_notesAbsoluteFilePath)) {
+    QMessageBox::warning(this, "Opening issue", p_errorString);
+  }
+  NoteRichTextEdit* notesTextEdit = getNotesTextEditFromPosition(position);
+  notesTextEdit->openNotes(p_content);
+  notesTextEdit->setEnabled(true);
+}
+
+
+/// PRIVATE
+
+void BrowseSourceWidget::openDocumentInEditor(QString const& p_fileName, QString const& p_absoluteFilePath, int p_lineNumber) {
   QFile sourceFile(p_absoluteFilePath);
   if (!sourceFile.exists()) {
     qDebug() << "404 Not Found" << "The file\n"+p_absoluteFilePath+"\ndoes not exist on this computer.";
     return;
   }
 
-  CodeEditor::FileType fileType;
-  if (p_fileName.endsWith("_p.h")) {
-    fileType = CodeEditor::ePrivateH;
-  } else if (p_fileName.endsWith(".h")) {
-    fileType = CodeEditor::eH;
-  } else if (p_fileName.endsWith(".cpp")) {
-    fileType = CodeEditor::eCpp;
+  FileTypes::FileType fileType = FileTypes::fileType(p_fileName);
+
+  // Documents shown lately are set back as they were, files not read yet are shown once read
+  // and any earlier request still being read is then dropped
+  m_sourcesAndOpenFilesWidget->insertDocument(p_fileName, p_absoluteFilePath);
+  m_pendingSourceAbsoluteFilePath.clear();
+  QString content;
+  if (sourceFile.size() > LargeFileViewer::sizeThreshold()) {
+    if (!m_sourceCodeEditorWidget->openLargeFile(p_absoluteFilePath)) {
+      QMessageBox::warning(this, "Opening issue", "The file\n"+p_absoluteFilePath+"\ncannot be read.");
+    }
+    goToLineNumber(p_lineNumber);
+  } else if (m_sourceCodeEditorWidget->openCachedSourceCode(p_absoluteFilePath)) {
+    goToLineNumber(p_lineNumber);
+  } else if (m_fileLoader->cachedContent(p_absoluteFilePath, content)) {
+    m_sourceCodeEditorWidget->openSourceCode(content, fileType, p_absoluteFilePath);
+    goToLineNumber(p_lineNumber);
   } else {
-    fileType = CodeEditor::eOtherFile;
+    m_pendingSourceAbsoluteFilePath = p_absoluteFilePath;
+    m_pendingLineNumber = p_lineNumber;
+    m_fileLoader->load(p_absoluteFilePath);
   }
+  m_fileLoader->prefetch(FileLoader::companionFilePaths(p_absoluteFilePath));
 
-  QString notesAbsoluteFilePath = m_browseFileInfo.getCurrentNotesAbsoluteFilePath();
+  // Notes cost nothing until the notes pane is shown
+  if (!m_noteRichTextEditStackWidget->isHidden()) {
+    showCurrentNotes();
+  }
 
-  m_sourcesAndOpenFilesWidget->insertDocument(p_fileName, p_absoluteFilePath);
-  m_sourceCodeEditorWidget->openSourceCode(getFileContent(p_absoluteFilePath), fileType);
+  m_sourceCodeEditorWidget->setFocusToSourceEditor();
+
+  emit enableSplitRequested();
+}
+
+void BrowseSourceWidget::openSourceCodeAtLine(QString const& p_fileName, QString const& p_absoluteFilePath, int p_lineNumber) {
+  m_browseFileInfo.appendNotesAndOpenDocument(p_absoluteFilePath, p_fileName);
+
+  openDocumentInEditor(p_fileName, p_absoluteFilePath, p_lineNumber);
+
+  m_sourcesAndOpenFilesWidget->setCurrentIndex(p_fileName, p_absoluteFilePath);
+
+  requestUpdateFileAction();
+}
+
+void BrowseSourceWidget::goToLineNumber(int p_lineNumber) {
+  if (p_lineNumber > 0) {
+    m_sourceCodeEditorWidget->goToLineNumber(p_lineNumber);
+  }
+}
+
+void BrowseSourceWidget::showCurrentNotes() {
+  QString notesAbsoluteFilePath = m_browseFileInfo.getCurrentNotesAbsoluteFilePath();
+  if (notesAbsoluteFilePath.isEmpty()) {
+    return;
+  }
 
   int position = m_browseFileInfo.getNotesPositionInStack(notesAbsoluteFilePath);
   if (position > -1) {
@@ -461,19 +576,18 @@ void BrowseSourceWidget::openDocumentInEditor(QString const& p_fileName, QString
   } else {
     openNotes(notesAbsoluteFilePath);
   }
-
-  m_sourceCodeEditorWidget->setFocusToSourceEditor();
-
-  emit enableSplitRequested();
 }
 
 void BrowseSourceWidget::openNotes(QString const& p_notesAbsoluteFilePath) {
+  // The editor is shown disabled until its notes are read
   NoteRichTextEdit* notesTextEdit = new NoteRichTextEdit;
-  notesTextEdit->openNotes(getFileContent(p_notesAbsoluteFilePath));
+  notesTextEdit->setEnabled(false);
+  m_notesLoader->load(p_notesAbsoluteFilePath);
 
-  connect(notesTextEdit, SIGNAL(contextMenuRequested(QString)), m_sourcesAndOpenFilesWidget, SLOT(openSourceCodeFromFileName(QString)));
+  connect(notesTextEdit, SIGNAL(contextMenuRequested(QString)), this, SLOT(openSymbolDefinition(QString)));
   connect(notesTextEdit, SIGNAL(saveNotesRequested()), this, SLOT(saveNotesFromSource()));
   connect(notesTextEdit, SIGNAL(modificationsNotSaved(bool)), this, SLOT(updateSaveStateToNotes(bool)));
+  connect(notesTextEdit, SIGNAL(modificationsNotSaved(bool)), this, SLOT(scheduleNotesAutosave(bool)));
 
   int position = m_noteRichTextEditStackWidget->addWidget(notesTextEdit);
   m_noteRichTextEditStackWidget->setCurrentIndex(position);
@@ -5,10 +5,13 @@
 #include <QSplitter>
 #include <QFileInfo>
 #include <QMessageBox>
+#include <QSet>
 
 #include "SourcesAndOpenFiles.hxx"
 #include "SourceCodeEditor.hxx"
 #include "NoteRichTextEdit.hxx"
+#include "FileLoader.hxx"
+#include "NoteSaver.hxx"
 
 #include <QDebug>
 
@@ -205,8 +208,15 @@ protected slots:
   void openSourceCodeFromSearch(QModelIndex const& p_index);
   void openSourceCodeFromOpenDocuments(QModelIndex const& p_index);
   void openSourceCodeFromContextualMenu(QModelIndex const& p_index);
+  void openSourceCodeFromGrep(QModelIndex const& p_index);
+  void openSymbolDefinition(QString const& p_symbol);
   void updateSaveStateToNotes(bool p_value, QString const& p_absoluteFilePath = "");
   void requestUpdateFileAction();
+  void openLoadedSourceCode(QString const& p_absoluteFilePath, QString const& p_content, bool p_succeeded, QString const& p_errorString);
+  void scheduleNotesAutosave(bool p_modified);
+  void autosaveNotes(QStringList const& p_absoluteFilePaths);
+  void updateSavedNotes(QString const& p_absoluteFilePath, bool p_succeeded, QString const& p_errorString);
+  void openLoadedNotes(QString const& p_notesAbsoluteFilePath, QString const& p_content, bool p_succeeded, QString const& p_errorString);
 
 signals:
   void enableSplitRequested();
@@ -216,8 +226,12 @@ signals:
   void enableCloseActionRequested(bool);
 
 private:
-  QString getFileContent(QString const& p_absoluteFilePath);
-  void openDocumentInEditor(QString const& p_fileName, QString const& p_absoluteFilePath);
+  /// Shows the document at once if it is cached or large, once read otherwise, then goes to the line if any
+  void openDocumentInEditor(QString const& p_fileName, QString const& p_absoluteFilePath, int p_lineNumber = 0);
+  void openSourceCodeAtLine(QString const& p_fileName, QString const& p_absoluteFilePath, int p_lineNumber);
+  void goToLineNumber(int p_lineNumber);
+  /// Shows the notes of the current document, their editor is created the first time
+  void showCurrentNotes();
   void openNotes(QString const& p_notesAbsoluteFilePath);
 
   BrowseFileInfo m_browseFileInfo;
@@ -226,6 +240,16 @@ private:
   SourceCodeEditor* m_sourceCodeEditorWidget;
   QStackedWidget* m_noteRichTextEditStackWidget;
   QSplitter* m_sourcesNotesSplitter;
+
+  FileLoader* m_fileLoader;
+  QString m_pendingSourceAbsoluteFilePath;
+  int m_pendingLineNumber;
+
+  NoteSaver* m_noteSaver;
+  /// Notes whose last save failed, so that a failure is reported once until they are saved again
+  QSet<QString> m_notesWithSaveError;
+  /// Reads the notes of an editor once created
+  FileLoader* m_notesLoader;
 };
 
 #endif // BROWSESOURCEWIDGET_HXX
@@ -42,26 +42,164 @@
 
 #include <QPainter>
 #include <QTextBlock>
-#include <QPair>
-#include <QRegularExpression>
+#include <QTextDocument>
+#include <QPlainTextDocumentLayout>
+#include <QScrollBar>
+#include <QStyleOptionSlider>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <QRunnable>
+#include <QElapsedTimer>
 
 #include <QDebug>
 
+#include "CppDeclarationParser.hxx"
+
+namespace {
+  /// Longest time the outline goes without reporting the methods it found
+  qint64 const g_outlineBatchMs = 50;
+
+  /// Keeps function signatures, with their white space simplified, by start position
+  class OutlineCollector {
+  public:
+    OutlineCollector(QChar const* p_text, bool p_declarations):
+      m_text(p_text),
+      m_declarations(p_declarations),
+      m_methods() {
+    }
+
+    QMap<int, QString> takeMethods() {
+      QMap<int, QString> methods;
+      methods.swap(m_methods);
+      return methods;
+    }
+
+    void declarationFound(CppDeclaration const& p_declaration) {
+      if (p_declaration.kind != CppDeclaration::eFunctionDeclaration || (!p_declaration.definition && !m_declarations)) {
+        return;
+      }
+      QString signature(m_text+p_declaration.statementStart, p_declaration.headEnd-p_declaration.statementStart);
+      m_methods.insert(p_declaration.statementStart, signature.simplified());
+    }
+
+  private:
+    QChar const* m_text;
+    bool m_declarations;
+    QMap<int, QString> m_methods;
+  };
+}
+
+class DocumentWorker: public QRunnable {
+public:
+  DocumentWorker(CodeEditor* p_editor, QString const& p_content, LineIndex const& p_lineIndex, CodeEditor::OutlineKind p_outlineKind, int p_generation):
+    QRunnable(),
+    m_editor(p_editor),
+    m_content(p_content),
+    m_lineIndex(p_lineIndex),
+    m_outlineKind(p_outlineKind),
+    m_generation(p_generation) {
+
+    setAutoDelete(true);
+  }
+
+  void run() override {
+    // The document is lexed once, the highlighter and the outline share its tokens
+    DocumentTokens tokens;
+    if (!tokens.tokenize(m_content, m_lineIndex, m_editor->m_documentGeneration, m_generation)) {
+      return;
+    }
+    emit m_editor->documentTokenized(m_generation, tokens);
+    if (m_outlineKind == CodeEditor::eNoOutline) {
+      emit m_editor->documentPrepared(m_generation);
+      return;
+    }
+
+    // Methods are reported by batches, the first ones do not wait for the end of the file
+    OutlineCollector collector(m_content.constData(), m_outlineKind == CodeEditor::eDeclarationsOutline);
+    CppDeclarationParser<QChar, OutlineCollector> parser(m_content.constData(), m_content.size(), collector);
+    parser.setTokens(&tokens);
+    QElapsedTimer batchTimer;
+    bool finished = false;
+    while (!finished && isCurrent()) {
+      batchTimer.start();
+      finished = parser.parse(&batchTimer, g_outlineBatchMs);
+      QMap<int, QString> methods = collector.takeMethods();
+      if (!methods.isEmpty() && isCurrent()) {
+        emit m_editor->methodsFound(m_generation, methods);
+      }
+    }
+    if (finished && isCurrent()) {
+      emit m_editor->documentPrepared(m_generation);
+    }
+  }
+
+private:
+  bool isCurrent() const {
+    return m_editor->m_documentGeneration.load() == m_generation;
+  }
+
+  CodeEditor* m_editor;
+  QString m_content;
+  LineIndex m_lineIndex;
+  CodeEditor::OutlineKind m_outlineKind;
+  int m_generation;
+};
+
+
 CodeEditor::CodeEditor(QWidget* p_parent):
   QPlainTextEdit(p_parent),
   m_lineNumberArea(new LineNumberArea(this)),
+  m_matchScrollBar(new MatchScrollBar(this)),
+  m_content(),
+  m_lineIndex(),
   m_methodsPerLineMap(),
-  m_commentsVector() {
+  m_documentTokens(),
+  m_documentThreadPool(),
+  m_documentGeneration(0),
+  m_absoluteFilePath(),
+  m_fileType(FileTypes::eOtherFile),
+  m_fileLastModified(),
+  m_fileSize(0),
+  m_documentPrepared(false),
+  m_documentCache(),
+  m_matchStarts(),
+  m_matchLengths(),
+  m_visibleMatchesStart(0),
+  m_visibleMatchesEnd(0) {
+
+  setVerticalScrollBar(m_matchScrollBar);
+  connect(m_matchScrollBar, SIGNAL(valueChanged(int)), this, SLOT(updateVisibleMatches()));
 
   connect(this, SIGNAL(blockCountChanged(int)), this, SLOT(updateLineNumberAreaWidth(int)));
   connect(this, SIGNAL(updateRequest(QRect,int)), this, SLOT(updateLineNumberArea(QRect,int)));
   connect(this, SIGNAL(cursorPositionChanged()), this, SLOT(highlightCurrentLine()));
 
+  m_documentThreadPool.setMaxThreadCount(1);
+  qRegisterMetaType<QMap<int, QString>>("QMap<int,QString>");
+  qRegisterMetaType<DocumentTokens>("DocumentTokens");
+  connect(this, SIGNAL(documentTokenized(int,DocumentTokens)), this, SLOT(setDocumentTokens(int,DocumentTokens)), Qt::QueuedConnection);
+  connect(this, SIGNAL(documentPrepared(int)), this, SLOT(markDocumentPrepared(int)), Qt::QueuedConnection);
+  connect(this, SIGNAL(methodsFound(int,QMap<int,QString>)), this, SLOT(appendMethods(int,QMap<int,QString>)), Qt::QueuedConnection);
+
   setLineWrapMode(QPlainTextEdit::NoWrap);
   updateLineNumberAreaWidth(0);
   highlightCurrentLine();
 }
 
+CodeEditor::~CodeEditor() {
+  m_documentGeneration.fetchAndAddOrdered(1);
+  m_documentThreadPool.clear();
+  m_documentThreadPool.waitForDone();
+
+  // Documents of the cache are deleted with it, the current one is not the editor's child
+  QTextDocument* currentDocument = document();
+  if (currentDocument->parent() == nullptr) {
+    setDocument(nullptr);
+    delete currentDocument;
+  }
+}
+
 int CodeEditor::lineNumberAreaWidth() {
   int digits = 1;
   int max = qMax(1, blockCount());
@@ -92,75 +230,100 @@ void CodeEditor::updateLineNumberArea(QRect const& p_rect, int p_dy) {
   }
 }
 
-void CodeEditor::openSourceCode(const QString& p_content, FileType p_fileType) {
-  setPlainText(p_content);
-  m_methodsPerLineMap.clear();
-  m_commentsVector.clear();
-
-  QString content = toPlainText();
-
-  // Fill comments map
-  QRegExp commentStartExpression("/\\*");
-  QRegExp commentEndExpression("\\*/");
-
-  int startIndex = commentStartExpression.indexIn(content);
-
-  while (startIndex >= 0) {
-    int endIndex = commentEndExpression.indexIn(content, startIndex);
-    QPair<int, int> currentCommentLines(startIndex, endIndex);
-    if (endIndex == -1) {
-      currentCommentLines.second = content.length();
-    }
-    m_commentsVector.append(currentCommentLines);
-    startIndex = commentStartExpression.indexIn(content, endIndex);
+void CodeEditor::openSourceCode(const QString& p_content, FileTypes::FileType p_fileType, QString const& p_absoluteFilePath) {
+  // Positions of the content are those of the document, whose blocks end with a single separator
+  QString content = p_content;
+  if (content.contains(QLatin1Char('\r'))) {
+    content.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+    content.replace(QLatin1Char('\r'), QLatin1Char('\n'));
   }
 
-  // Fill methods map
-  QRegularExpression methodName;
-  methodName.setPatternOptions(QRegularExpression::DotMatchesEverythingOption | QRegularExpression::InvertedGreedinessOption);
+  // Not laid out in the editor, the previous document may still be cached
+  QTextDocument* newDocument = new QTextDocument();
+  newDocument->setDocumentLayout(new QPlainTextDocumentLayout(newDocument));
+  newDocument->setDefaultFont(font());
+  newDocument->setUndoRedoEnabled(false);
+  newDocument->setPlainText(content);
+  replaceDocument(newDocument);
+  m_content = content;
+  m_lineIndex.build(m_content);
+
+  m_absoluteFilePath = p_absoluteFilePath;
+  m_fileType = p_fileType;
+  QFileInfo fileInfo(p_absoluteFilePath);
+  m_fileLastModified = p_absoluteFilePath.isEmpty() ? QDateTime() : fileInfo.lastModified();
+  m_fileSize = p_absoluteFilePath.isEmpty() ? 0 : fileInfo.size();
+  m_documentPrepared = false;
+
+  int generation = m_documentGeneration.fetchAndAddOrdered(1)+1;
+  m_documentThreadPool.clear();
+  m_documentTokens = DocumentTokens();
+  emit documentTokensReady(m_documentTokens);
+  m_methodsPerLineMap.clear();
+  emit methodListReady(m_methodsPerLineMap);
 
+  // Definitions of source files, declarations and inline definitions of headers
+  OutlineKind outlineKind = eNoOutline;
   switch(p_fileType) {
-  case eCpp: {
-    //methodName.setPattern("\\n((const\\s+)?\\w+(::\\w+)?\\s*(\\*|&)*\\s*)?\\w+(::~?\\w+)?(\\s*operator\\s*.+\\s*)?\\(((\\s*const\\s+)?\\w+(::\\w+)?\\s*(\\*|&)*\\s*\\w*)?(\\s*,\\s*(const\\s+)?\\w+(::\\w+)?\\s*(\\*|&)?\\s*\\w*)*\\s*\\)[\\s\\w]*");
-    methodName.setPattern("\\n(\\w[\\w\\<\\*\\&\\,\\>:\\s]*)\\w+(::~?\\w+|::\\w+(::\\w+)*|\\s*operator\\s*..?\\s*)\\(.*\\)[\\n\\w\\s\\(\\):,]*\\n{");
+  case FileTypes::eCppFile:
+  case FileTypes::eCFile:
+  case FileTypes::eObjectiveCppFile: {
+    outlineKind = eDefinitionsOutline;
     break;
   }
-  case ePrivateH:
-  case eH: {
-    methodName.setPattern("\\n\\s*(\\w[\\w\\<\\*\\&\\,\\>:\\s]*)?(~?\\w+|\\s*operator\\s*..?\\s*)\\([\\w\\s,:=&\\*<>(\\(\\))]*\\)[\\n\\w\\s\\(\\):,]*(;|{)");
-    //methodName.setPattern("\n.*\\(.*\\n*\\).*;");
+  case FileTypes::ePrivateHFile:
+  case FileTypes::eHFile: {
+    outlineKind = eDeclarationsOutline;
     break;
   }
-  case eOtherFile:
   default: {
     break;
   }
   }
+  m_documentThreadPool.start(new DocumentWorker(this, m_content, m_lineIndex, outlineKind, generation));
+}
 
-  //QTextCursor cursor = textCursor();
-  int ind = -1;
-  QRegularExpressionMatchIterator it = methodName.globalMatch(content);
-  while (it.hasNext()) {
-    QRegularExpressionMatch match = it.next();
-    if (match.hasMatch()) {
-      ind = match.capturedStart() + 2;
-      if (!methodIsInComment(ind)) {
-        QString methodMatched = match.captured(0);
-        if (methodMatched.contains("return") || methodMatched.contains("typename")) {
-          continue;
-        }
-        QRegularExpression labelRegEx("\\n\\s*(public|private|protected|Q_SIGNALS|(public|private|protected)\\s+Q_SLOTS)\\s*:\\s*\\n");
-        int labelOffset = labelRegEx.match(methodMatched).captured(0).length();
-        ind += labelOffset;
-        methodMatched = methodMatched.remove(0, labelOffset+1).trimmed();
-        m_methodsPerLineMap.insert(ind, methodMatched.split(QRegularExpression("\\n{")).first().split(QRegularExpression("\\n\\s*:")).first().split(QRegularExpression("\\n\\s*")).join(" "));
-      }
+bool CodeEditor::openCachedSourceCode(QString const& p_absoluteFilePath) {
+  if (!p_absoluteFilePath.isEmpty() && p_absoluteFilePath == m_absoluteFilePath) {
+    QFileInfo fileInfo(p_absoluteFilePath);
+    if (fileInfo.lastModified() == m_fileLastModified && fileInfo.size() == m_fileSize) {
+      return true;
     }
   }
 
-  //for(auto const& s:m_methodsPerLineMap)qDebug()<<s<<"\n";
+  DocumentCache::Entry entry;
+  if (!m_documentCache.take(p_absoluteFilePath, entry)) {
+    return false;
+  }
+
+  // Compressed documents are laid out and analyzed again, without reading the file
+  if (entry.document == nullptr) {
+    openSourceCode(QString::fromUtf8(qUncompress(entry.compressedContent)), entry.fileType, p_absoluteFilePath);
+    return true;
+  }
 
+  m_documentGeneration.fetchAndAddOrdered(1);
+  m_documentThreadPool.clear();
+  replaceDocument(entry.document);
+  m_content = entry.content;
+  m_lineIndex = entry.lineIndex;
+
+  m_absoluteFilePath = p_absoluteFilePath;
+  m_fileType = entry.fileType;
+  m_fileLastModified = entry.lastModified;
+  m_fileSize = entry.size;
+  m_documentPrepared = true;
+
+  QTextCursor cursor(entry.document);
+  cursor.setPosition(qMin(entry.cursorPosition, entry.document->characterCount()-1));
+  setTextCursor(cursor);
+  verticalScrollBar()->setValue(entry.verticalScrollValue);
+
+  m_documentTokens = entry.tokens;
+  emit documentTokensReady(m_documentTokens);
+  m_methodsPerLineMap = entry.methods;
   emit methodListReady(m_methodsPerLineMap);
+  return true;
 }
 
 void CodeEditor::resizeEvent(QResizeEvent* p_event) {
@@ -168,6 +331,7 @@ void CodeEditor::resizeEvent(QResizeEvent* p_event) {
 
   QRect cr = contentsRect();
   m_lineNumberArea->setGeometry(QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
+  updateVisibleMatches();
 }
 
 void CodeEditor::highlightCurrentLine() {
@@ -185,9 +349,61 @@ void CodeEditor::highlightCurrentLine() {
     extraSelections.append(selection);
   }
 
+  appendVisibleMatchSelections(extraSelections);
   setExtraSelections(extraSelections);
 }
 
+void CodeEditor::updateVisibleMatches() {
+  if (m_matchStarts.isEmpty()) {
+    return;
+  }
+
+  // Selections are laid out again only once other lines come in the viewport
+  QTextBlock firstBlock = firstVisibleBlock();
+  QTextBlock lastBlock = cursorForPosition(QPoint(0, viewport()->height())).block();
+  if (firstBlock.position() >= m_visibleMatchesStart && lastBlock.position()+lastBlock.length() <= m_visibleMatchesEnd) {
+    return;
+  }
+  highlightCurrentLine();
+}
+
+void CodeEditor::goToPosition(int p_position) {
+  int position = qBound(0, p_position, qMax(0, document()->characterCount()-1));
+  QTextCursor cursor(document());
+  cursor.setPosition(position);
+  setTextCursor(cursor);
+
+  // Without wrapping, lines are blocks and the scroll bar counts blocks
+  int visibleLineCount = viewport()->height()/qMax(1, fontMetrics().height());
+  verticalScrollBar()->setValue(m_lineIndex.lineAt(position)-visibleLineCount/2);
+}
+
+void CodeEditor::goToLineNumber(int p_lineNumber) {
+  if (p_lineNumber < 1 || p_lineNumber > m_lineIndex.lineCount()) {
+    return;
+  }
+
+  goToPosition(m_lineIndex.lineStart(p_lineNumber-1));
+}
+
+void CodeEditor::setMatches(QVector<int> const& p_matchStarts, QVector<int> const& p_matchLengths) {
+  m_matchStarts = p_matchStarts;
+  m_matchLengths = p_matchLengths;
+
+  QVector<int> matchDensity;
+  if (!m_matchStarts.isEmpty()) {
+    matchDensity.fill(0, MatchScrollBar::bucketCount());
+    for (int matchStart: m_matchStarts) {
+      ++matchDensity[int(qint64(m_lineIndex.lineAt(matchStart))*MatchScrollBar::bucketCount()/m_lineIndex.lineCount())];
+    }
+  }
+  m_matchScrollBar->setMatchDensity(matchDensity);
+
+  m_visibleMatchesStart = 0;
+  m_visibleMatchesEnd = 0;
+  highlightCurrentLine();
+}
+
 void CodeEditor::lineNumberAreaPaintEvent(QPaintEvent* p_event) {
   QPainter painter(m_lineNumberArea);
   painter.fillRect(p_event->rect(), QColor("#EFEFEF"));
@@ -211,18 +427,122 @@ void CodeEditor::lineNumberAreaPaintEvent(QPaintEvent* p_event) {
   }
 }
 
-void CodeEditor::setPlainText(const QString& p_text) {
-  QPlainTextEdit::setPlainText(p_text);
+void CodeEditor::setDocumentTokens(int p_generation, DocumentTokens const& p_tokens) {
+  if (p_generation != m_documentGeneration.load()) {
+    return;
+  }
+
+  m_documentTokens = p_tokens;
+  emit documentTokensReady(m_documentTokens);
+}
+
+void CodeEditor::markDocumentPrepared(int p_generation) {
+  if (p_generation == m_documentGeneration.load()) {
+    m_documentPrepared = true;
+  }
 }
 
-bool CodeEditor::methodIsInComment(int p_methodStartIndex) const {
-  for (auto indexes: m_commentsVector) {
-    if (p_methodStartIndex < indexes.first) {
-      return false;
-    } else if (indexes.first <= p_methodStartIndex && p_methodStartIndex <= indexes.second) {
-      return true;
-    }
+void CodeEditor::appendMethods(int p_generation, QMap<int, QString> const& p_methods) {
+  if (p_generation != m_documentGeneration.load()) {
+    return;
+  }
+
+  for (auto method = p_methods.constBegin(); method != p_methods.constEnd(); ++method) {
+    m_methodsPerLineMap.insert(method.key(), method.value());
+  }
+  emit methodListReady(m_methodsPerLineMap);
+}
+
+void CodeEditor::appendVisibleMatchSelections(QList<QTextEdit::ExtraSelection>& p_extraSelections) {
+  if (m_matchStarts.isEmpty()) {
+    return;
+  }
+
+  // Matches of the lines in the viewport, a page above and below it, found by binary search
+  int visibleLineCount = viewport()->height()/qMax(1, fontMetrics().height())+1;
+  QTextBlock firstBlock = firstVisibleBlock();
+  for (int k = 0; k < visibleLineCount && firstBlock.previous().isValid(); ++k) {
+    firstBlock = firstBlock.previous();
+  }
+  QTextBlock lastBlock = cursorForPosition(QPoint(0, viewport()->height())).block();
+  for (int k = 0; k < visibleLineCount && lastBlock.next().isValid(); ++k) {
+    lastBlock = lastBlock.next();
+  }
+  m_visibleMatchesStart = firstBlock.position();
+  m_visibleMatchesEnd = lastBlock.position()+lastBlock.length();
+
+  int firstMatch = int(std::lower_bound(m_matchStarts.cbegin(), m_matchStarts.cend(), m_visibleMatchesStart)-m_matchStarts.cbegin());
+  int lastMatch = int(std::lower_bound(m_matchStarts.cbegin(), m_matchStarts.cend(), m_visibleMatchesEnd)-m_matchStarts.cbegin());
+  QColor markColor = QColor(Qt::yellow).lighter(150);
+  QTextCursor cursor(document());
+  for (int k = firstMatch; k < lastMatch; ++k) {
+    QTextEdit::ExtraSelection selection;
+    selection.format.setBackground(markColor);
+    cursor.setPosition(m_matchStarts.at(k));
+    cursor.setPosition(m_matchStarts.at(k)+m_matchLengths.at(k), QTextCursor::KeepAnchor);
+    selection.cursor = cursor;
+    p_extraSelections.append(selection);
+  }
+}
+
+void CodeEditor::replaceDocument(QTextDocument* p_document) {
+  // The first document belongs to the editor, which deletes it on setDocument
+  QTextDocument* previousDocument = document();
+  bool editorDocument = previousDocument->parent() != nullptr;
+
+  DocumentCache::Entry entry;
+  entry.document = previousDocument;
+  entry.content = m_content;
+  entry.lineIndex = m_lineIndex;
+  entry.fileType = m_fileType;
+  entry.tokens = m_documentTokens;
+  entry.methods = m_methodsPerLineMap;
+  entry.lastModified = m_fileLastModified;
+  entry.size = m_fileSize;
+  entry.cursorPosition = textCursor().position();
+  entry.verticalScrollValue = verticalScrollBar()->value();
+
+  // Matches were of the previous document
+  m_matchStarts.clear();
+  m_matchLengths.clear();
+  m_matchScrollBar->setMatchDensity(QVector<int>());
+
+  setDocument(p_document);
+  updateLineNumberAreaWidth(0);
+  highlightCurrentLine();
+  if (editorDocument) {
+    return;
+  }
+
+  // Only documents fully highlighted and outlined are cached
+  if (!m_absoluteFilePath.isEmpty() && m_documentPrepared) {
+    m_documentCache.insert(m_absoluteFilePath, entry);
+  } else {
+    delete previousDocument;
+  }
+}
+
+
+void MatchScrollBar::paintEvent(QPaintEvent* p_event) {
+  QScrollBar::paintEvent(p_event);
+  if (m_matchDensity.isEmpty()) {
+    return;
   }
 
-  return false;
+  // One mark per bucket holding matches, darker as it holds more
+  QStyleOptionSlider option;
+  initStyleOption(&option);
+  QRect groove = style()->subControlRect(QStyle::CC_ScrollBar, &option, QStyle::SC_ScrollBarGroove, this);
+  int maximumCount = *std::max_element(m_matchDensity.cbegin(), m_matchDensity.cend());
+  QPainter painter(this);
+  for (int bucket = 0; bucket < m_matchDensity.size(); ++bucket) {
+    int count = m_matchDensity.at(bucket);
+    if (count == 0) {
+      continue;
+    }
+    QColor markColor(Qt::darkYellow);
+    markColor.setAlpha(96+159*count/maximumCount);
+    int top = groove.top()+bucket*groove.height()/m_matchDensity.size();
+    painter.fillRect(groove.left()+2, top, groove.width()-4, qMax(2, groove.height()/m_matchDensity.size()), markColor);
+  }
 }
@@ -42,6 +42,14 @@
 #define CODEEDITOR_H
 
 #include <QPlainTextEdit>
+#include <QScrollBar>
+#include <QThreadPool>
+#include <QAtomicInt>
+
+#include "FileTypes.hxx"
+#include "DocumentTokens.hxx"
+#include "DocumentCache.hxx"
+#include "LineIndex.hxx"
 
 class QPaintEvent;
 class QResizeEvent;
@@ -49,24 +57,38 @@ class QSize;
 class QWidget;
 
 class LineNumberArea;
+class MatchScrollBar;
 
 
 class CodeEditor: public QPlainTextEdit {
   Q_OBJECT
 
-public:
-  enum FileType {
-    eCpp,
-    eH,
-    ePrivateH,
-    eOtherFile
-  };
+  friend class DocumentWorker;
 
+public:
   CodeEditor(QWidget* p_parent = nullptr);
+  ~CodeEditor();
 
   void lineNumberAreaPaintEvent(QPaintEvent* p_event);
   int lineNumberAreaWidth();
-  void openSourceCode(QString const& p_content, FileType p_fileType);
+  /// Shows a new document, the previous one goes to the cache if it is of a file and prepared
+  void openSourceCode(QString const& p_content, FileTypes::FileType p_fileType, QString const& p_absoluteFilePath = QString());
+  /// Shows the cached document of a file unchanged since, returns false if there is none
+  bool openCachedSourceCode(QString const& p_absoluteFilePath);
+
+  /// Puts the cursor at a position of the document, its line in the middle of the viewport
+  void goToPosition(int p_position);
+  /// Same for the start of a line, numbered from 1
+  void goToLineNumber(int p_lineNumber);
+  LineIndex const& lineIndex() const { return m_lineIndex; }
+
+  /// Marks search matches of the current document, those in the viewport only are laid out as selections
+  void setMatches(QVector<int> const& p_matchStarts, QVector<int> const& p_matchLengths);
+
+  /// Text of the current document, line feeds only
+  QString const& content() const { return m_content; }
+  /// Tokens of the current content, empty until it has been lexed
+  DocumentTokens const& documentTokens() const { return m_documentTokens; }
 
 protected:
   void resizeEvent(QResizeEvent* p_event) override;
@@ -74,18 +96,53 @@ protected:
 private slots:
   void updateLineNumberAreaWidth(int p_newBlockCount);
   void highlightCurrentLine();
+  void updateVisibleMatches();
   void updateLineNumberArea(QRect const& p_rect, int p_dy);
+  void setDocumentTokens(int p_generation, DocumentTokens const& p_tokens);
+  void markDocumentPrepared(int p_generation);
+  void appendMethods(int p_generation, QMap<int, QString> const& p_methods);
 
 signals:
+  /// Tokens of the current content, sent empty when it is replaced and again once lexed
+  void documentTokensReady(DocumentTokens);
+  /// Methods found so far, sent again as the outline worker finds more
   void methodListReady(QMap<int, QString>);
+  void documentTokenized(int p_generation, DocumentTokens p_tokens);
+  void methodsFound(int p_generation, QMap<int, QString> p_methods);
+  void documentPrepared(int p_generation);
 
 private:
-  void setPlainText(const QString& p_text);
-  bool methodIsInComment(int p_methodStartIndex) const;
+  enum OutlineKind {
+    eNoOutline,
+    eDefinitionsOutline,
+    eDeclarationsOutline
+  };
+
+  void replaceDocument(QTextDocument* p_document);
+  void appendVisibleMatchSelections(QList<QTextEdit::ExtraSelection>& p_extraSelections);
 
   QWidget* m_lineNumberArea;
+  MatchScrollBar* m_matchScrollBar;
+  QString m_content;
+  LineIndex m_lineIndex;
   QMap<int, QString> m_methodsPerLineMap;
-  QVector<QPair<int, int>> m_commentsVector;
+  DocumentTokens m_documentTokens;
+  QThreadPool m_documentThreadPool;
+  QAtomicInt m_documentGeneration;
+
+  QString m_absoluteFilePath;
+  FileTypes::FileType m_fileType;
+  QDateTime m_fileLastModified;
+  qint64 m_fileSize;
+  /// Tokens and methods all received
+  bool m_documentPrepared;
+  DocumentCache m_documentCache;
+
+  QVector<int> m_matchStarts;
+  QVector<int> m_matchLengths;
+  /// Positions of the document the match selections were laid out for
+  int m_visibleMatchesStart;
+  int m_visibleMatchesEnd;
 };
 
 
@@ -111,4 +168,30 @@ private:
 };
 
 
+/// Vertical scroll bar with the density of search matches along its groove.
+/// Matches are counted in a fixed number of buckets once per search, so that
+/// painting does not depend on their number.
+class MatchScrollBar: public QScrollBar {
+
+public:
+  MatchScrollBar(QWidget* p_parent):
+    QScrollBar(Qt::Vertical, p_parent),
+    m_matchDensity() {
+  }
+
+  static int bucketCount() { return 256; }
+  /// Match counts per bucket, empty if there is no match
+  void setMatchDensity(QVector<int> const& p_matchDensity) {
+    m_matchDensity = p_matchDensity;
+    update();
+  }
+
+protected:
+  void paintEvent(QPaintEvent* p_event) override;
+
+private:
+  QVector<int> m_matchDensity;
+};
+
+
 #endif
@@ -0,0 +1,448 @@
+#include "ContentIndex.hxx"
+
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QStandardPaths>
+#include <QDebug>
+
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+
+namespace {
+  quint32 const g_contentIndexMagic = 0x51534354; // "QSCT"
+  quint32 const g_contentIndexVersion = 1;
+  qint64 const g_maximumFileSize = 32*1024*1024;
+  qint64 const g_binaryCheckLength = 1024;
+
+  struct ContentIndexHeader {
+    quint32 magic;
+    quint32 version;
+    quint32 rootDirectoryNameBytes;
+    quint32 filesCount;
+    quint32 pathsBytes;
+    quint32 trigramsCount;
+    quint64 postingsBytes;
+  };
+
+  struct TrigramEntry {
+    quint32 trigram;
+    quint32 filesCount;
+    quint64 postingsOffset;
+  };
+
+  struct PostingList {
+    QByteArray deltas;
+    int lastFileId = -1;
+    int filesCount = 0;
+  };
+
+  qint64 alignedSize(qint64 p_size) {
+    return (p_size+7) & ~qint64(7);
+  }
+
+  void appendPadding(QByteArray& p_bytes) {
+    p_bytes.append(QByteArray(alignedSize(p_bytes.size())-p_bytes.size(), '\0'));
+  }
+
+  template <typename T>
+  void appendRaw(QByteArray& p_bytes, T const& p_value) {
+    p_bytes.append(reinterpret_cast<char const*>(&p_value), sizeof(T));
+  }
+
+  void appendVarint(QByteArray& p_bytes, quint32 p_value) {
+    while (p_value >= 0x80) {
+      p_bytes.append(char((p_value & 0x7f) | 0x80));
+      p_value >>= 7;
+    }
+    p_bytes.append(char(p_value));
+  }
+
+  uchar foldCase(uchar p_byte) {
+    return (p_byte >= 'A' && p_byte <= 'Z') ? p_byte+('a'-'A') : p_byte;
+  }
+
+  /// Distinct case folded trigrams of a file, p_seenTrigrams is a 2^24 bits set left cleared
+  void collectTrigrams(QString const& p_absoluteFilePath, quint64* p_seenTrigrams, QVector<quint32>& p_trigrams) {
+    p_trigrams.clear();
+
+    QFile file(p_absoluteFilePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+      return;
+    }
+    qint64 size = file.size();
+    if (size < 3 || size > g_maximumFileSize) {
+      return;
+    }
+
+    QByteArray content;
+    uchar const* data = file.map(0, size);
+    if (data == nullptr) {
+      content = file.readAll();
+      data = reinterpret_cast<uchar const*>(content.constData());
+      size = content.size();
+    }
+    if (std::memchr(data, '\0', qMin(size, g_binaryCheckLength)) != nullptr) {
+      return;
+    }
+
+    quint32 trigram = (quint32(foldCase(data[0])) << 8) | foldCase(data[1]);
+    for (qint64 k = 2; k < size; ++k) {
+      trigram = ((trigram << 8) | foldCase(data[k])) & 0xffffff;
+      quint64 bit = quint64(1) << (trigram & 63);
+      if ((p_seenTrigrams[trigram >> 6] & bit) == 0) {
+        p_seenTrigrams[trigram >> 6] |= bit;
+        p_trigrams << trigram;
+      }
+    }
+
+    for (quint32 seenTrigram: p_trigrams) {
+      p_seenTrigrams[seenTrigram >> 6] = 0;
+    }
+  }
+}
+
+ContentIndex::ContentIndex():
+  m_file(),
+  m_data(nullptr),
+  m_size(0),
+  m_fileIds(),
+  m_filesLastModified(),
+  m_trigramEntries(nullptr),
+  m_trigramCount(0),
+  m_postings(nullptr),
+  m_postingsBytes(0),
+  m_updatedFiles() {
+}
+
+ContentIndex::~ContentIndex() {
+  if (m_data != nullptr) {
+    m_file.unmap(const_cast<uchar*>(m_data));
+  }
+}
+
+/// Public
+
+QString ContentIndex::defaultFileName() {
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)+QDir::separator()+"contentIndex.trigrams";
+}
+
+bool ContentIndex::load(QString const& p_fileName, QString const& p_rootDirectoryName) {
+  m_file.setFileName(p_fileName);
+  if (!m_file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+
+  qint64 size = m_file.size();
+  if (size < qint64(sizeof(ContentIndexHeader))) {
+    return false;
+  }
+
+  uchar const* data = m_file.map(0, size);
+  if (data == nullptr) {
+    return false;
+  }
+
+  ContentIndexHeader header;
+  std::memcpy(&header, data, sizeof(ContentIndexHeader));
+  if (header.magic != g_contentIndexMagic || header.version != g_contentIndexVersion) {
+    m_file.unmap(const_cast<uchar*>(data));
+    return false;
+  }
+
+  // Sections offsets, each section starts on a 8 bytes boundary
+  qint64 rootDirectoryNameOffset = sizeof(ContentIndexHeader);
+  qint64 pathOffsetsOffset = alignedSize(rootDirectoryNameOffset+header.rootDirectoryNameBytes);
+  qint64 pathsOffset = pathOffsetsOffset+(qint64(header.filesCount)+1)*sizeof(quint32);
+  qint64 filesLastModifiedOffset = alignedSize(pathsOffset+header.pathsBytes);
+  qint64 trigramEntriesOffset = filesLastModifiedOffset+qint64(header.filesCount)*sizeof(qint64);
+  qint64 postingsOffset = trigramEntriesOffset+qint64(header.trigramsCount)*sizeof(TrigramEntry);
+  QString rootDirectoryName = QString::fromUtf8(reinterpret_cast<char const*>(data+rootDirectoryNameOffset), qMin<qint64>(header.rootDirectoryNameBytes, size-rootDirectoryNameOffset));
+  if (postingsOffset+qint64(header.postingsBytes) > size || rootDirectoryName != p_rootDirectoryName) {
+    m_file.unmap(const_cast<uchar*>(data));
+    return false;
+  }
+
+  // Paths are relative to the root directory
+  QVector<quint32> pathOffsets(header.filesCount+1);
+  std::memcpy(pathOffsets.data(), data+pathOffsetsOffset, pathOffsets.size()*sizeof(quint32));
+  QHash<QString, int> fileIds;
+  fileIds.reserve(header.filesCount);
+  for (quint32 k = 0; k < header.filesCount; ++k) {
+    if (pathOffsets.at(k) > pathOffsets.at(k+1) || pathOffsets.at(k+1) > header.pathsBytes) {
+      m_file.unmap(const_cast<uchar*>(data));
+      return false;
+    }
+    fileIds.insert(QString::fromUtf8(reinterpret_cast<char const*>(data+pathsOffset+pathOffsets.at(k)), pathOffsets.at(k+1)-pathOffsets.at(k)), k);
+  }
+
+  m_filesLastModified.resize(header.filesCount);
+  std::memcpy(m_filesLastModified.data(), data+filesLastModifiedOffset, header.filesCount*sizeof(qint64));
+
+  m_data = data;
+  m_size = size;
+  m_fileIds = fileIds;
+  m_trigramEntries = data+trigramEntriesOffset;
+  m_trigramCount = header.trigramsCount;
+  m_postings = data+postingsOffset;
+  m_postingsBytes = header.postingsBytes;
+  return true;
+}
+
+bool ContentIndex::build(QString const& p_fileName, SourceIndex const& p_sourceIndex, QAtomicInt const& p_currentGeneration, int p_generation) {
+  QString rootDirectoryName = p_sourceIndex.rootDirectoryName();
+  QByteArray paths;
+  QVector<quint32> pathOffsets;
+  QVector<qint64> filesLastModified;
+  pathOffsets.reserve(p_sourceIndex.fileCount()+1);
+  filesLastModified.reserve(p_sourceIndex.fileCount());
+
+  // Files are read in id order, so posting lists are sorted and their deltas small
+  QHash<quint32, PostingList> postingLists;
+  QVector<quint64> seenTrigrams(1 << 18, 0);
+  QVector<quint32> fileTrigrams;
+  for (int fileId = 0; fileId < p_sourceIndex.fileCount(); ++fileId) {
+    if (p_currentGeneration.load() != p_generation) {
+      return false;
+    }
+
+    QString absoluteFilePath = p_sourceIndex.absoluteFilePath(fileId);
+    pathOffsets << paths.size();
+    paths.append(absoluteFilePath.mid(rootDirectoryName.size()+1).toUtf8());
+    filesLastModified << p_sourceIndex.fileLastModified(fileId);
+
+    collectTrigrams(absoluteFilePath, seenTrigrams.data(), fileTrigrams);
+    for (quint32 trigram: fileTrigrams) {
+      PostingList& postingList = postingLists[trigram];
+      appendVarint(postingList.deltas, fileId-postingList.lastFileId);
+      postingList.lastFileId = fileId;
+      ++postingList.filesCount;
+    }
+  }
+  pathOffsets << paths.size();
+
+  QVector<quint32> trigrams = QVector<quint32>::fromList(postingLists.keys());
+  std::sort(trigrams.begin(), trigrams.end());
+
+  QByteArray rootDirectoryNameBytes = rootDirectoryName.toUtf8();
+  ContentIndexHeader header;
+  header.magic = g_contentIndexMagic;
+  header.version = g_contentIndexVersion;
+  header.rootDirectoryNameBytes = rootDirectoryNameBytes.size();
+  header.filesCount = filesLastModified.size();
+  header.pathsBytes = paths.size();
+  header.trigramsCount = trigrams.size();
+  header.postingsBytes = 0;
+
+  QByteArray trigramEntries;
+  trigramEntries.reserve(trigrams.size()*sizeof(TrigramEntry));
+  for (quint32 trigram: trigrams) {
+    PostingList const& postingList = postingLists[trigram];
+    TrigramEntry entry;
+    entry.trigram = trigram;
+    entry.filesCount = postingList.filesCount;
+    entry.postingsOffset = header.postingsBytes;
+    appendRaw(trigramEntries, entry);
+    header.postingsBytes += postingList.deltas.size();
+  }
+
+  QByteArray bytes;
+  appendRaw(bytes, header);
+  bytes.append(rootDirectoryNameBytes);
+  appendPadding(bytes);
+  bytes.append(reinterpret_cast<char const*>(pathOffsets.constData()), pathOffsets.size()*sizeof(quint32));
+  bytes.append(paths);
+  appendPadding(bytes);
+  bytes.append(reinterpret_cast<char const*>(filesLastModified.constData()), filesLastModified.size()*sizeof(qint64));
+  bytes.append(trigramEntries);
+
+  QDir().mkpath(QFileInfo(p_fileName).absolutePath());
+  QSaveFile indexFile(p_fileName);
+  if (!indexFile.open(QIODevice::WriteOnly)) {
+    qDebug() << "Cannot write content index" << indexFile.errorString();
+    return false;
+  }
+  indexFile.write(bytes);
+  for (quint32 trigram: trigrams) {
+    indexFile.write(postingLists[trigram].deltas);
+  }
+  return indexFile.commit();
+}
+
+bool ContentIndex::indexUpdatedFiles(SourceIndex const& p_sourceIndex, ContentIndex const& p_previousIndex, QAtomicInt const& p_currentGeneration, int p_generation) {
+  m_updatedFiles.clear();
+
+  QVector<quint64> seenTrigrams(1 << 18, 0);
+  QVector<quint32> fileTrigrams;
+  for (int fileId = 0; fileId < p_sourceIndex.fileCount(); ++fileId) {
+    if (p_currentGeneration.load() != p_generation) {
+      return false;
+    }
+    if (indexedFileId(p_sourceIndex, fileId) >= 0) {
+      continue;
+    }
+
+    // Files unchanged since the previous update are not read again
+    QString relativePath = relativeFilePath(p_sourceIndex, fileId);
+    qint64 lastModified = p_sourceIndex.fileLastModified(fileId);
+    auto previousFile = p_previousIndex.m_updatedFiles.constFind(relativePath);
+    if (previousFile != p_previousIndex.m_updatedFiles.constEnd() && previousFile->lastModified == lastModified) {
+      m_updatedFiles.insert(relativePath, previousFile.value());
+      continue;
+    }
+
+    collectTrigrams(p_sourceIndex.absoluteFilePath(fileId), seenTrigrams.data(), fileTrigrams);
+    std::sort(fileTrigrams.begin(), fileTrigrams.end());
+    UpdatedFile updatedFile;
+    updatedFile.lastModified = lastModified;
+    updatedFile.trigrams = fileTrigrams;
+    updatedFile.trigrams.squeeze();
+    m_updatedFiles.insert(relativePath, updatedFile);
+  }
+  return true;
+}
+
+QVector<quint32> ContentIndex::queryTrigrams(QStringList const& p_literals, Qt::CaseSensitivity p_caseSensitivity) {
+  QVector<quint32> trigrams;
+  for (QString const& literal: p_literals) {
+    // Only ASCII letters are case folded in the index
+    bool asciiLiteral = std::all_of(literal.cbegin(), literal.cend(), [](QChar p_char) { return p_char.unicode() < 0x80; });
+    if (p_caseSensitivity == Qt::CaseInsensitive && !asciiLiteral) {
+      continue;
+    }
+
+    QByteArray bytes = literal.toUtf8();
+    for (int k = 0; k+2 < bytes.size(); ++k) {
+      trigrams << ((quint32(foldCase(bytes.at(k))) << 16) | (quint32(foldCase(bytes.at(k+1))) << 8) | foldCase(bytes.at(k+2)));
+    }
+  }
+
+  std::sort(trigrams.begin(), trigrams.end());
+  trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+  return trigrams;
+}
+
+QVector<int> ContentIndex::candidateFiles(SourceIndex const& p_sourceIndex, QVector<quint32> const& p_trigrams) const {
+  QVector<int> fileIds;
+  fileIds.reserve(p_sourceIndex.fileCount());
+  if (!isLoaded() || p_trigrams.isEmpty()) {
+    for (int fileId = 0; fileId < p_sourceIndex.fileCount(); ++fileId) {
+      fileIds << fileId;
+    }
+    return fileIds;
+  }
+
+  // Rarest trigrams first, the intersection only gets smaller
+  QVector<QPair<int, quint32>> trigramsByFrequency;
+  for (quint32 trigram: p_trigrams) {
+    TrigramEntry const* entries = reinterpret_cast<TrigramEntry const*>(m_trigramEntries);
+    TrigramEntry const* entry = std::lower_bound(entries, entries+m_trigramCount, trigram, [](TrigramEntry const& p_entry, quint32 p_trigram) { return p_entry.trigram < p_trigram; });
+    trigramsByFrequency << qMakePair(entry != entries+m_trigramCount && entry->trigram == trigram ? int(entry->filesCount) : 0, trigram);
+  }
+  std::sort(trigramsByFrequency.begin(), trigramsByFrequency.end());
+
+  QVector<int> indexedFileIds;
+  if (trigramsByFrequency.first().first > 0) {
+    indexedFileIds = postings(trigramsByFrequency.first().second);
+  }
+  for (int k = 1; k < trigramsByFrequency.size() && !indexedFileIds.isEmpty(); ++k) {
+    QVector<int> trigramFileIds = postings(trigramsByFrequency.at(k).second);
+    QVector<int> intersection;
+    intersection.reserve(indexedFileIds.size());
+    std::set_intersection(indexedFileIds.constBegin(), indexedFileIds.constEnd(), trigramFileIds.constBegin(), trigramFileIds.constEnd(), std::back_inserter(intersection));
+    indexedFileIds = intersection;
+  }
+
+  QVector<bool> matchedFiles(m_filesLastModified.size(), false);
+  for (int indexedFileId: indexedFileIds) {
+    matchedFiles[indexedFileId] = true;
+  }
+
+  // Files missing from the index or modified since are read anyway, unless their trigrams were collected since
+  for (int fileId = 0; fileId < p_sourceIndex.fileCount(); ++fileId) {
+    int indexedId = indexedFileId(p_sourceIndex, fileId);
+    if (indexedId >= 0) {
+      if (matchedFiles.at(indexedId)) {
+        fileIds << fileId;
+      }
+      continue;
+    }
+
+    UpdatedFile const* file = updatedFile(p_sourceIndex, fileId);
+    if (file == nullptr || std::includes(file->trigrams.cbegin(), file->trigrams.cend(), p_trigrams.cbegin(), p_trigrams.cend())) {
+      fileIds << fileId;
+    }
+  }
+  return fileIds;
+}
+
+int ContentIndex::unindexedFileCount(SourceIndex const& p_sourceIndex) const {
+  if (!isLoaded()) {
+    return p_sourceIndex.fileCount();
+  }
+
+  int unindexedCount = 0;
+  for (int fileId = 0; fileId < p_sourceIndex.fileCount(); ++fileId) {
+    if (indexedFileId(p_sourceIndex, fileId) < 0 && updatedFile(p_sourceIndex, fileId) == nullptr) {
+      ++unindexedCount;
+    }
+  }
+  return unindexedCount;
+}
+
+
+/// Private
+
+QString ContentIndex::relativeFilePath(SourceIndex const& p_sourceIndex, int p_fileId) {
+  return p_sourceIndex.absoluteFilePath(p_fileId).mid(p_sourceIndex.rootDirectoryName().size()+1);
+}
+
+int ContentIndex::indexedFileId(SourceIndex const& p_sourceIndex, int p_fileId) const {
+  int indexedId = m_fileIds.value(relativeFilePath(p_sourceIndex, p_fileId), -1);
+  if (indexedId < 0 || m_filesLastModified.at(indexedId) != p_sourceIndex.fileLastModified(p_fileId)) {
+    return -1;
+  }
+  return indexedId;
+}
+
+ContentIndex::UpdatedFile const* ContentIndex::updatedFile(SourceIndex const& p_sourceIndex, int p_fileId) const {
+  if (m_updatedFiles.isEmpty()) {
+    return nullptr;
+  }
+
+  auto file = m_updatedFiles.constFind(relativeFilePath(p_sourceIndex, p_fileId));
+  if (file == m_updatedFiles.constEnd() || file->lastModified != p_sourceIndex.fileLastModified(p_fileId)) {
+    return nullptr;
+  }
+  return &file.value();
+}
+
+QVector<int> ContentIndex::postings(quint32 p_trigram) const {
+  QVector<int> fileIds;
+  TrigramEntry const* entries = reinterpret_cast<TrigramEntry const*>(m_trigramEntries);
+  TrigramEntry const* entry = std::lower_bound(entries, entries+m_trigramCount, p_trigram, [](TrigramEntry const& p_entry, quint32 p_trigram) { return p_entry.trigram < p_trigram; });
+  if (entry == entries+m_trigramCount || entry->trigram != p_trigram) {
+    return fileIds;
+  }
+
+  fileIds.reserve(entry->filesCount);
+  qint64 position = entry->postingsOffset;
+  int fileId = -1;
+  for (quint32 k = 0; k < entry->filesCount; ++k) {
+    quint32 delta = 0;
+    for (int shift = 0; position < m_postingsBytes && shift < 32; shift += 7) {
+      uchar byte = m_postings[position++];
+      delta |= quint32(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        break;
+      }
+    }
+    fileId += delta;
+    if (delta == 0 || fileId >= m_filesLastModified.size()) {
+      break;
+    }
+    fileIds << fileId;
+  }
+  return fileIds;
+}
@@ -0,0 +1,75 @@
+#ifndef CONTENTINDEX_HXX
+#define CONTENTINDEX_HXX
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QFile>
+#include <QAtomicInt>
+
+#include "SourceIndex.hxx"
+
+/// On-disk trigram index of the content of the source files. Every trigram
+/// has the sorted ids of the files containing it, delta and varint encoded,
+/// and the index file is mapped so that a query only reads the posting lists
+/// of its own trigrams. ASCII letters are case folded, as in the queries.
+///
+/// Files are identified by their path and last modification time, so files
+/// added or modified since the index was built are always candidates, until
+/// their trigrams are collected in memory by indexUpdatedFiles().
+class ContentIndex {
+public:
+  ContentIndex();
+  ~ContentIndex();
+
+  static QString defaultFileName();
+
+  bool load(QString const& p_fileName, QString const& p_rootDirectoryName);
+  bool isLoaded() const { return m_data != nullptr; }
+
+  /// Indexes every file of the source index, gives up once p_currentGeneration moves past p_generation
+  static bool build(QString const& p_fileName, SourceIndex const& p_sourceIndex, QAtomicInt const& p_currentGeneration, int p_generation);
+
+  /// Trigrams every match contains, from the literals every match contains
+  static QVector<quint32> queryTrigrams(QStringList const& p_literals, Qt::CaseSensitivity p_caseSensitivity);
+  /// Collects in memory the trigrams of the files added or modified since the index was built,
+  /// reusing those of p_previousIndex still current, gives up as build() does
+  bool indexUpdatedFiles(SourceIndex const& p_sourceIndex, ContentIndex const& p_previousIndex, QAtomicInt const& p_currentGeneration, int p_generation);
+
+  /// Ids of the source index files that may contain all the trigrams
+  QVector<int> candidateFiles(SourceIndex const& p_sourceIndex, QVector<quint32> const& p_trigrams) const;
+  /// Files neither in the index file nor collected in memory
+  int unindexedFileCount(SourceIndex const& p_sourceIndex) const;
+  int updatedFileCount() const { return m_updatedFiles.size(); }
+
+private:
+  Q_DISABLE_COPY(ContentIndex)
+
+  struct UpdatedFile {
+    qint64 lastModified;
+    /// Sorted
+    QVector<quint32> trigrams;
+  };
+
+  static QString relativeFilePath(SourceIndex const& p_sourceIndex, int p_fileId);
+  int indexedFileId(SourceIndex const& p_sourceIndex, int p_fileId) const;
+  UpdatedFile const* updatedFile(SourceIndex const& p_sourceIndex, int p_fileId) const;
+  QVector<int> postings(quint32 p_trigram) const;
+
+  QFile m_file;
+  uchar const* m_data;
+  qint64 m_size;
+
+  QHash<QString, int> m_fileIds;
+  QVector<qint64> m_filesLastModified;
+  uchar const* m_trigramEntries;
+  int m_trigramCount;
+  uchar const* m_postings;
+  qint64 m_postingsBytes;
+
+  /// By path relative to the root directory
+  QHash<QString, UpdatedFile> m_updatedFiles;
+};
+
+#endif // CONTENTINDEX_HXX
@@ -0,0 +1,78 @@
+#include "ContentIndexBuilder.hxx"
+
+#include <QRunnable>
+
+class ContentIndexBuilderWorker: public QRunnable {
+public:
+  ContentIndexBuilderWorker(ContentIndexBuilder* p_builder, SourceIndex const& p_sourceIndex, QString const& p_fileName, QSharedPointer<ContentIndex const> const& p_previousIndex, int p_generation):
+    QRunnable(),
+    m_builder(p_builder),
+    m_sourceIndex(p_sourceIndex),
+    m_fileName(p_fileName),
+    m_previousIndex(p_previousIndex),
+    m_generation(p_generation) {
+
+    setAutoDelete(true);
+  }
+
+  void run() override {
+    // Updates map the index file again and only read the files changed since it was built
+    if (!m_previousIndex.isNull()) {
+      QSharedPointer<ContentIndex> contentIndex(new ContentIndex);
+      if (contentIndex->load(m_fileName, m_sourceIndex.rootDirectoryName())) {
+        bool updated = contentIndex->indexUpdatedFiles(m_sourceIndex, *m_previousIndex, m_builder->m_generation, m_generation);
+        if (updated && m_builder->m_generation.load() == m_generation) {
+          emit m_builder->updateFinished(contentIndex);
+        }
+        return;
+      }
+    }
+
+    bool built = ContentIndex::build(m_fileName, m_sourceIndex, m_builder->m_generation, m_generation);
+    if (m_builder->m_generation.load() == m_generation) {
+      emit m_builder->buildFinished(m_fileName, built);
+    }
+  }
+
+private:
+  ContentIndexBuilder* m_builder;
+  SourceIndex m_sourceIndex;
+  QString m_fileName;
+  QSharedPointer<ContentIndex const> m_previousIndex;
+  int m_generation;
+};
+
+
+ContentIndexBuilder::ContentIndexBuilder(QObject* p_parent):
+  QObject(p_parent),
+  m_threadPool(),
+  m_generation(0) {
+
+  // Reading the whole tree once is enough, one thread keeps the others free for searches
+  m_threadPool.setMaxThreadCount(1);
+  qRegisterMetaType<QSharedPointer<ContentIndex const>>("QSharedPointer<const ContentIndex>");
+}
+
+ContentIndexBuilder::~ContentIndexBuilder() {
+  cancel();
+  m_threadPool.waitForDone();
+}
+
+/// Public
+
+void ContentIndexBuilder::start(SourceIndex const& p_sourceIndex, QString const& p_fileName) {
+  int generation = m_generation.fetchAndAddOrdered(1)+1;
+  m_threadPool.clear();
+  m_threadPool.start(new ContentIndexBuilderWorker(this, p_sourceIndex, p_fileName, QSharedPointer<ContentIndex const>(), generation));
+}
+
+void ContentIndexBuilder::update(QSharedPointer<ContentIndex const> const& p_contentIndex, SourceIndex const& p_sourceIndex, QString const& p_fileName) {
+  int generation = m_generation.fetchAndAddOrdered(1)+1;
+  m_threadPool.clear();
+  m_threadPool.start(new ContentIndexBuilderWorker(this, p_sourceIndex, p_fileName, p_contentIndex, generation));
+}
+
+void ContentIndexBuilder::cancel() {
+  m_generation.fetchAndAddOrdered(1);
+  m_threadPool.clear();
+}
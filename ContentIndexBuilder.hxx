@@ -0,0 +1,39 @@
+#ifndef CONTENTINDEXBUILDER_HXX
+#define CONTENTINDEXBUILDER_HXX
+
+#include <QObject>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QSharedPointer>
+
+#include "SourceIndex.hxx"
+#include "ContentIndex.hxx"
+
+/// Builds the content index of a copy of the source index on a worker thread,
+/// or updates it with the files changed since it was built. Starting a new
+/// build or update cancels the previous one.
+class ContentIndexBuilder: public QObject {
+  Q_OBJECT
+
+  friend class ContentIndexBuilderWorker;
+
+public:
+  explicit ContentIndexBuilder(QObject* p_parent = nullptr);
+  ~ContentIndexBuilder();
+
+  void start(SourceIndex const& p_sourceIndex, QString const& p_fileName);
+  /// Collects the trigrams of the files changed since the index file was written, it is built again if it cannot be loaded
+  void update(QSharedPointer<ContentIndex const> const& p_contentIndex, SourceIndex const& p_sourceIndex, QString const& p_fileName);
+  void cancel();
+  bool isRunning() const { return m_threadPool.activeThreadCount() > 0; }
+
+signals:
+  void buildFinished(QString p_fileName, bool p_built);
+  void updateFinished(QSharedPointer<ContentIndex const> p_contentIndex);
+
+private:
+  QThreadPool m_threadPool;
+  QAtomicInt m_generation;
+};
+
+#endif // CONTENTINDEXBUILDER_HXX
@@ -0,0 +1,670 @@
+#ifndef CPPDECLARATIONPARSER_HXX
+#define CPPDECLARATIONPARSER_HXX
+
+#include <QChar>
+#include <QVector>
+#include <QElapsedTimer>
+
+#include <cstring>
+
+#include "DocumentTokens.hxx"
+
+/// Class, enum or function found at namespace or class scope.
+struct CppDeclaration {
+  enum Kind {
+    eClassDeclaration,
+    eEnumDeclaration,
+    eFunctionDeclaration
+  };
+
+  Kind kind;
+  /// Followed by a body rather than by a semicolon
+  bool definition;
+  /// First character of the declaration
+  int statementStart;
+  /// End of the signature, before any constructor initializer list or body
+  int headEnd;
+  int nameStart;
+  int nameLength;
+  /// Class of a method defined out of it, empty otherwise
+  int qualifierStart;
+  int qualifierLength;
+  int lineNumber;
+};
+
+/// Single linear pass over a C or C++ text, of bytes or of QChars. Comments,
+/// literals, preprocessor lines and function bodies are skipped, statements
+/// at namespace or class scope are followed just enough to tell what a brace
+/// or a semicolon ends: the last of a type keyword, a function parameter list
+/// or an assignment. Declarations are reported to the handler as they are
+/// found, through declarationFound(CppDeclaration const&).
+///
+/// Parsing may be split in time-bounded steps, each resuming where the
+/// previous one stopped. Given the tokens the document was lexed into, the
+/// parser jumps over their comments, literals and directives rather than
+/// scanning them again.
+template <typename Char, typename Handler>
+class CppDeclarationParser {
+public:
+  CppDeclarationParser(Char const* p_data, int p_size, Handler& p_handler):
+    m_data(p_data),
+    m_size(p_size),
+    m_handler(p_handler),
+    m_position(0),
+    m_lineNumber(1),
+    m_atLineStart(true),
+    m_tokens(nullptr),
+    m_tokenLine(0),
+    m_tokenId(0),
+    m_scopes(),
+    m_statement() {
+  }
+
+  /// Tokens of the same text, which must outlive the parser
+  void setTokens(DocumentTokens const* p_tokens) {
+    m_tokens = p_tokens != nullptr && !p_tokens->isEmpty() ? p_tokens : nullptr;
+  }
+
+  int position() const { return m_position; }
+  bool atEnd() const { return m_position >= m_size; }
+
+  /// Parses to the end, or until p_maximumMs have elapsed on p_timer. Returns true once at the end.
+  bool parse(QElapsedTimer const* p_timer = nullptr, qint64 p_maximumMs = 0) {
+    int stepCount = 0;
+    while (m_position < m_size) {
+      if (p_timer != nullptr && (++stepCount & 0xfff) == 0 && p_timer->elapsed() >= p_maximumMs) {
+        return false;
+      }
+      if (skipSpaceOrComment()) {
+        continue;
+      }
+
+      int character = code(m_data[m_position]);
+      bool recording = m_scopes.isEmpty() || m_scopes.last() == eDeclarationScope;
+      if (!recording) {
+        if (character == '{') {
+          m_scopes << eSkippedScope;
+        } else if (character == '}') {
+          m_scopes.removeLast();
+        }
+        skipToken();
+        continue;
+      }
+
+      if (m_statement.start < 0) {
+        m_statement.start = m_position;
+      }
+      if (isIdentifierStart(character)) {
+        identifier(readIdentifier());
+      } else if (character >= '0' && character <= '9') {
+        skipToken();
+      } else {
+        punctuation(character);
+      }
+    }
+    return true;
+  }
+
+private:
+  enum ScopeKind {
+    eDeclarationScope,
+    eSkippedScope
+  };
+
+  enum TypeKeyword {
+    eNoTypeKeyword,
+    eClassKeyword,
+    eEnumKeyword,
+    eNamespaceKeyword
+  };
+
+  struct Token {
+    int start = 0;
+    int length = 0;
+    int lineNumber = 0;
+  };
+
+  /// What has been seen since the last brace or semicolon, orders tell which came last
+  struct Statement {
+    int start = -1;
+    int order = 0;
+    TypeKeyword typeKeyword = eNoTypeKeyword;
+    int typeOrder = 0;
+    Token typeName;
+    bool typeHeadDone = false;
+    int angleDepth = 0;
+    Token functionName;
+    Token functionQualifier;
+    int functionOrder = 0;
+    int assignmentOrder = 0;
+    bool initializerList = false;
+    int initializerListStart = -1;
+    Token lastIdentifier;
+    Token lastQualifier;
+    Token scopeQualifier;
+    bool lastIsIdentifier = false;
+    bool lastIsScope = false;
+    bool lastIsCloseAngle = false;
+    bool destructorPending = false;
+    int destructorStart = -1;
+    int identifierCount = 0;
+    bool externStatement = false;
+  };
+
+  static int code(char p_character) { return static_cast<unsigned char>(p_character); }
+  static int code(QChar p_character) { return p_character.unicode(); }
+
+  static bool isIdentifierStart(int p_code) {
+    // Bytes of UTF-8 sequences and non-ASCII characters are taken as letters
+    return (p_code >= 'a' && p_code <= 'z') || (p_code >= 'A' && p_code <= 'Z') || p_code == '_' || p_code >= 0x80;
+  }
+
+  static bool isIdentifierCharacter(int p_code) {
+    return isIdentifierStart(p_code) || (p_code >= '0' && p_code <= '9');
+  }
+
+  static bool isSpace(int p_code) {
+    return p_code == ' ' || p_code == '\t' || p_code == '\r' || p_code == '\n' || p_code == '\f' || p_code == '\v';
+  }
+
+  int codeAt(int p_position) const {
+    return p_position < m_size ? code(m_data[p_position]) : 0;
+  }
+
+  bool tokenIs(Token const& p_token, char const* p_word) const {
+    int length = int(std::strlen(p_word));
+    if (length != p_token.length) {
+      return false;
+    }
+    for (int k = 0; k < length; ++k) {
+      if (code(m_data[p_token.start+k]) != code(p_word[k])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool tokenStartsWith(Token const& p_token, char const* p_prefix) const {
+    int length = int(std::strlen(p_prefix));
+    if (p_token.length <= length) {
+      return false;
+    }
+    for (int k = 0; k < length; ++k) {
+      if (code(m_data[p_token.start+k]) != code(p_prefix[k])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  template <int N>
+  bool tokenIsOneOf(Token const& p_token, char const* const (&p_words)[N]) const {
+    for (char const* word: p_words) {
+      if (tokenIs(p_token, word)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// Macro-like names, capitals, digits and underscores only
+  bool isMacroName(Token const& p_token) const {
+    if (p_token.length < 2) {
+      return false;
+    }
+    for (int k = 0; k < p_token.length; ++k) {
+      int character = code(m_data[p_token.start+k]);
+      if (!((character >= 'A' && character <= 'Z') || (character >= '0' && character <= '9') || character == '_')) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void advance() {
+    if (code(m_data[m_position]) == '\n') {
+      ++m_lineNumber;
+      m_atLineStart = true;
+    }
+    ++m_position;
+  }
+
+  /// Skips white space, comments, literals and preprocessor lines, returns true if anything was skipped
+  bool skipSpaceOrComment() {
+    int character = code(m_data[m_position]);
+    int next = codeAt(m_position+1);
+    if (isSpace(character)) {
+      advance();
+    } else if (m_tokens != nullptr && skipLexedToken()) {
+      m_atLineStart = false;
+    } else if (character == '#' && m_atLineStart) {
+      skipPreprocessorLine();
+    } else if (character == '/' && next == '/') {
+      while (m_position < m_size && code(m_data[m_position]) != '\n') {
+        advance();
+      }
+    } else if (character == '/' && next == '*') {
+      m_position += 2;
+      while (m_position < m_size && !(code(m_data[m_position]) == '*' && codeAt(m_position+1) == '/')) {
+        advance();
+      }
+      m_position = qMin(m_position+2, m_size);
+    } else if (character == '"' || character == '\'') {
+      skipQuoted(character);
+    } else {
+      m_atLineStart = false;
+      return false;
+    }
+    return true;
+  }
+
+  void skipPreprocessorLine() {
+    while (m_position < m_size && !(code(m_data[m_position]) == '\n' && code(m_data[m_position-1]) != '\\')) {
+      advance();
+    }
+  }
+
+  /// Skips the comment, literal or directive lexed at the position, returns false if there is none
+  bool skipLexedToken() {
+    // Positions only grow, so does the cursor over the tokens
+    while (m_tokenLine+1 < m_tokens->lineCount() && m_tokens->lineStart(m_tokenLine+1) <= m_position) {
+      ++m_tokenLine;
+      m_tokenId = m_tokens->lineFirstToken(m_tokenLine);
+    }
+    int column = m_position-m_tokens->lineStart(m_tokenLine);
+    int tokenEnd = m_tokens->lineTokenEnd(m_tokenLine);
+    while (m_tokenId < tokenEnd && m_tokens->token(m_tokenId).start+m_tokens->token(m_tokenId).length <= column) {
+      ++m_tokenId;
+    }
+    if (m_tokenId == tokenEnd || m_tokens->token(m_tokenId).start > column) {
+      return false;
+    }
+
+    // Tokens do not span lines, those of a block comment or a raw string follow each other line after line
+    CppLexer::Token const& token = m_tokens->token(m_tokenId);
+    switch (token.kind) {
+    case CppLexer::eCommentToken:
+    case CppLexer::eStringToken: {
+      m_position = qMin(m_tokens->lineStart(m_tokenLine)+token.start+token.length, m_size);
+      return true;
+    }
+    case CppLexer::eDirectiveToken:
+    case CppLexer::eIncludeToken: {
+      skipPreprocessorLine();
+      return true;
+    }
+    default: {
+      return false;
+    }
+    }
+  }
+
+  void skipQuoted(int p_quote) {
+    m_atLineStart = false;
+    ++m_position;
+    while (m_position < m_size && code(m_data[m_position]) != p_quote && code(m_data[m_position]) != '\n') {
+      if (code(m_data[m_position]) == '\\' && m_position+1 < m_size) {
+        advance();
+      }
+      advance();
+    }
+    if (m_position < m_size && code(m_data[m_position]) == p_quote) {
+      ++m_position;
+    }
+  }
+
+  void skipRawString() {
+    // R"delimiter( ... )delimiter"
+    int delimiterStart = m_position+1;
+    int open = delimiterStart;
+    while (open < m_size && open-delimiterStart <= 16 && code(m_data[open]) != '(') {
+      ++open;
+    }
+    if (open >= m_size || code(m_data[open]) != '(') {
+      skipQuoted('"');
+      return;
+    }
+
+    int delimiterLength = open-delimiterStart;
+    m_position = open+1;
+    while (m_position < m_size) {
+      if (code(m_data[m_position]) == ')' && isRawStringEnd(delimiterStart, delimiterLength)) {
+        m_position = qMin(m_position+delimiterLength+2, m_size);
+        return;
+      }
+      advance();
+    }
+  }
+
+  bool isRawStringEnd(int p_delimiterStart, int p_delimiterLength) const {
+    for (int k = 0; k < p_delimiterLength; ++k) {
+      if (codeAt(m_position+1+k) != code(m_data[p_delimiterStart+k])) {
+        return false;
+      }
+    }
+    return codeAt(m_position+1+p_delimiterLength) == '"';
+  }
+
+  /// Skips a character, or a whole identifier or number
+  void skipToken() {
+    if (!isIdentifierCharacter(code(m_data[m_position]))) {
+      advance();
+      return;
+    }
+    while (m_position < m_size) {
+      int character = code(m_data[m_position]);
+      if (character == '\'' || character == '.') {
+        // Digit separators and decimal points only belong to numbers
+        int previous = code(m_data[m_position-1]);
+        if (!(previous >= '0' && previous <= '9')) {
+          break;
+        }
+      } else if (!isIdentifierCharacter(character)) {
+        break;
+      }
+      ++m_position;
+    }
+  }
+
+  /// Skips from an opening character to its closing one, nested ones included
+  void skipBalanced(int p_open, int p_close) {
+    int depth = 0;
+    while (m_position < m_size) {
+      if (skipSpaceOrComment()) {
+        continue;
+      }
+      int character = code(m_data[m_position]);
+      advance();
+      if (character == p_open) {
+        ++depth;
+      } else if (character == p_close && --depth == 0) {
+        return;
+      }
+    }
+  }
+
+  void skipSpaceAndComments() {
+    while (m_position < m_size && skipSpaceOrComment()) {
+    }
+  }
+
+  Token readIdentifier() {
+    Token token;
+    token.start = m_position;
+    token.lineNumber = m_lineNumber;
+    while (m_position < m_size && isIdentifierCharacter(code(m_data[m_position]))) {
+      ++m_position;
+    }
+    token.length = m_position-token.start;
+
+    // Raw string prefixes
+    if (codeAt(m_position) == '"' && (tokenIs(token, "R") || tokenIs(token, "LR") || tokenIs(token, "uR") || tokenIs(token, "UR") || tokenIs(token, "u8R"))) {
+      skipRawString();
+      token.length = 0;
+    } else if (tokenIs(token, "operator")) {
+      readOperatorName(token);
+    }
+    return token;
+  }
+
+  /// Extends an operator keyword to the operator it names: operator==, operator(), operator bool
+  void readOperatorName(Token& p_token) {
+    int end = m_position;
+    int position = m_position;
+    while (position < m_size && isSpace(code(m_data[position])) && code(m_data[position]) != '\n') {
+      ++position;
+    }
+    if (codeAt(position) == '(' && codeAt(position+1) == ')') {
+      end = position+2;
+    } else {
+      while (position < m_size) {
+        int character = code(m_data[position]);
+        if (character == '(' || character == ';' || character == '{' || character == '\n') {
+          break;
+        }
+        ++position;
+        if (!isSpace(character)) {
+          end = position;
+        }
+      }
+    }
+    m_position = end;
+    p_token.length = end-p_token.start;
+  }
+
+  bool isTypeLatest() const {
+    return m_statement.typeOrder > m_statement.functionOrder && m_statement.typeOrder > m_statement.assignmentOrder;
+  }
+
+  bool isFunctionLatest() const {
+    return m_statement.functionOrder > m_statement.typeOrder && m_statement.functionOrder > m_statement.assignmentOrder;
+  }
+
+  void identifier(Token p_token) {
+    if (p_token.length == 0) {
+      m_statement.lastIsIdentifier = false;
+      return;
+    }
+
+    // A lone macro without semicolon, Q_OBJECT or Q_GADGET, ends its statement at the end of its line
+    if (m_statement.identifierCount == 1 && m_statement.lastIsIdentifier && isMacroName(m_statement.lastIdentifier) && p_token.lineNumber > m_statement.lastIdentifier.lineNumber) {
+      m_statement = Statement();
+      m_statement.start = p_token.start;
+    }
+
+    Statement& statement = m_statement;
+
+    if (tokenIs(p_token, "class") || tokenIs(p_token, "struct") || tokenIs(p_token, "union")) {
+      // "enum class" is still an enum
+      bool enumClass = statement.typeKeyword == eEnumKeyword && isTypeLatest() && statement.typeName.length == 0;
+      if (!enumClass) {
+        startType(eClassKeyword);
+      }
+    } else if (tokenIs(p_token, "enum")) {
+      startType(eEnumKeyword);
+    } else if (tokenIs(p_token, "namespace")) {
+      startType(eNamespaceKeyword);
+    } else if (statement.typeKeyword != eNoTypeKeyword && isTypeLatest() && !statement.typeHeadDone && statement.angleDepth == 0 && !tokenIs(p_token, "final")) {
+      // The last name of the head, after any export macro
+      statement.typeName = p_token;
+    }
+
+    if (statement.identifierCount++ == 0 && tokenIs(p_token, "extern")) {
+      statement.externStatement = true;
+    }
+
+    // Destructor names keep their tilde
+    if (statement.destructorPending) {
+      p_token.length += p_token.start-statement.destructorStart;
+      p_token.start = statement.destructorStart;
+    }
+    statement.lastQualifier = statement.lastIsScope ? statement.scopeQualifier : Token();
+    statement.lastIdentifier = p_token;
+    statement.lastIsIdentifier = true;
+    statement.lastIsScope = false;
+    statement.lastIsCloseAngle = false;
+    statement.destructorPending = false;
+  }
+
+  void startType(TypeKeyword p_typeKeyword) {
+    m_statement.typeKeyword = p_typeKeyword;
+    m_statement.typeOrder = ++m_statement.order;
+    m_statement.typeName = Token();
+    m_statement.typeHeadDone = false;
+    m_statement.angleDepth = 0;
+  }
+
+  void punctuation(int p_character) {
+    static char const* const excludedCallNames[] = {
+      "if", "for", "while", "switch", "catch", "return", "sizeof", "decltype", "alignof", "alignas",
+      "noexcept", "throw", "static_assert", "defined", "__attribute__", "__declspec", "typeid", "new", "delete",
+      "void", "bool", "char", "short", "int", "long", "float", "double", "signed", "unsigned", "auto", "const", "volatile"
+    };
+    static char const* const accessSpecifiers[] = {
+      "public", "protected", "private", "signals", "slots", "Q_SIGNALS", "Q_SLOTS"
+    };
+
+    Statement& statement = m_statement;
+    bool lastIsIdentifier = statement.lastIsIdentifier;
+    bool lastIsCloseAngle = statement.lastIsCloseAngle;
+    statement.lastIsIdentifier = false;
+    statement.lastIsScope = false;
+    statement.lastIsCloseAngle = false;
+    if (p_character != '~') {
+      statement.destructorPending = false;
+    }
+
+    switch (p_character) {
+    case ':': {
+      if (codeAt(m_position+1) == ':') {
+        statement.scopeQualifier = lastIsIdentifier ? statement.lastIdentifier : Token();
+        statement.lastIsScope = true;
+        m_position += 2;
+        return;
+      }
+      if (lastIsIdentifier && tokenIsOneOf(statement.lastIdentifier, accessSpecifiers)) {
+        m_statement = Statement();
+      } else if (statement.typeKeyword != eNoTypeKeyword && isTypeLatest()) {
+        statement.typeHeadDone = true;
+      } else if (isFunctionLatest() && !statement.initializerList) {
+        statement.initializerList = true;
+        statement.initializerListStart = m_position;
+      }
+      break;
+    }
+    case '(': {
+      Token const& name = statement.lastIdentifier;
+      bool excluded = tokenIsOneOf(name, excludedCallNames) || tokenStartsWith(name, "Q_DECL_");
+      bool candidate = lastIsIdentifier && !statement.initializerList && statement.assignmentOrder == 0 && !excluded;
+      if (candidate) {
+        statement.functionName = name;
+        statement.functionQualifier = statement.lastQualifier;
+        statement.functionOrder = ++statement.order;
+      }
+      skipBalanced('(', ')');
+
+      // A lone macro call without semicolon, Q_PROPERTY(...) or Q_DECLARE_FLAGS(...), ends its statement
+      if (candidate && statement.identifierCount == 1 && isMacroName(name)) {
+        skipSpaceAndComments();
+        if (isIdentifierStart(codeAt(m_position))) {
+          m_statement = Statement();
+        }
+      }
+      return;
+    }
+    case '<': {
+      if (statement.typeName.length > 0 && isTypeLatest() && !statement.typeHeadDone) {
+        ++statement.angleDepth;
+      }
+      break;
+    }
+    case '>': {
+      if (statement.angleDepth > 0) {
+        --statement.angleDepth;
+      }
+      statement.lastIsCloseAngle = true;
+      break;
+    }
+    case '=': {
+      statement.assignmentOrder = ++statement.order;
+      break;
+    }
+    case '~': {
+      statement.destructorPending = true;
+      statement.destructorStart = m_position;
+      break;
+    }
+    case '{': {
+      // Braced member initializers belong to the constructor head
+      if (statement.initializerList && (lastIsIdentifier || lastIsCloseAngle)) {
+        skipBalanced('{', '}');
+        return;
+      }
+      openScope();
+      break;
+    }
+    case '}': {
+      if (!m_scopes.isEmpty()) {
+        m_scopes.removeLast();
+      }
+      m_statement = Statement();
+      break;
+    }
+    case ';': {
+      // Declarations without body, pure virtual and deleted ones included
+      if (statement.functionOrder > statement.typeOrder && !statement.initializerList && !isLoneMacroCall()) {
+        reportDeclaration(CppDeclaration::eFunctionDeclaration, false, statement.functionName, statement.functionQualifier);
+      }
+      m_statement = Statement();
+      break;
+    }
+    default: {
+      break;
+    }
+    }
+    advance();
+  }
+
+  bool isLoneMacroCall() const {
+    return m_statement.identifierCount == 1 && isMacroName(m_statement.functionName);
+  }
+
+  void openScope() {
+    Statement const& statement = m_statement;
+    ScopeKind scope = eSkippedScope;
+    if (statement.order == 0) {
+      // extern "C" blocks and bare blocks
+      if (statement.identifierCount == 0 || statement.externStatement) {
+        scope = eDeclarationScope;
+      }
+    } else if (isTypeLatest()) {
+      if (statement.typeKeyword == eNamespaceKeyword) {
+        scope = eDeclarationScope;
+      } else if (statement.typeKeyword == eClassKeyword) {
+        reportDeclaration(CppDeclaration::eClassDeclaration, true, statement.typeName, Token());
+        scope = eDeclarationScope;
+      } else {
+        reportDeclaration(CppDeclaration::eEnumDeclaration, true, statement.typeName, Token());
+      }
+    } else if (isFunctionLatest()) {
+      reportDeclaration(CppDeclaration::eFunctionDeclaration, true, statement.functionName, statement.functionQualifier);
+    }
+
+    m_scopes << scope;
+    m_statement = Statement();
+  }
+
+  void reportDeclaration(CppDeclaration::Kind p_kind, bool p_definition, Token const& p_name, Token const& p_qualifier) {
+    if (p_name.length == 0) {
+      return;
+    }
+
+    CppDeclaration declaration;
+    declaration.kind = p_kind;
+    declaration.definition = p_definition;
+    declaration.statementStart = m_statement.start < 0 ? p_name.start : m_statement.start;
+    declaration.headEnd = m_statement.initializerList ? m_statement.initializerListStart : m_position;
+    declaration.nameStart = p_name.start;
+    declaration.nameLength = p_name.length;
+    declaration.qualifierStart = p_qualifier.start;
+    declaration.qualifierLength = p_qualifier.length;
+    declaration.lineNumber = p_name.lineNumber;
+    m_handler.declarationFound(declaration);
+  }
+
+  Char const* m_data;
+  int m_size;
+  Handler& m_handler;
+  int m_position;
+  int m_lineNumber;
+  bool m_atLineStart;
+
+  DocumentTokens const* m_tokens;
+  int m_tokenLine;
+  int m_tokenId;
+
+  QVector<ScopeKind> m_scopes;
+  Statement m_statement;
+};
+
+#endif // CPPDECLARATIONPARSER_HXX
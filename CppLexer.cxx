@@ -0,0 +1,368 @@
+#include "CppLexer.hxx"
+
+namespace {
+  constexpr char const* g_keywords[] = {
+    "alignas", "alignof", "asm", "auto", "bool", "break", "case", "catch", "char", "char16_t", "char32_t",
+    "class", "const", "const_cast", "constexpr", "continue", "decltype", "default", "delete", "do", "double",
+    "dynamic_cast", "else", "emit", "enum", "explicit", "export", "extern", "false", "final", "float", "for",
+    "foreach", "forever", "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new",
+    "noexcept", "nullptr", "operator", "override", "private", "protected", "public", "register",
+    "reinterpret_cast", "return", "short", "signals", "signed", "sizeof", "slots", "static", "static_assert",
+    "static_cast", "struct", "switch", "template", "this", "thread_local", "throw", "true", "try", "typedef",
+    "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while",
+    "__attribute__", "__thread", "__typeof__"
+  };
+  constexpr int g_keywordCount = sizeof(g_keywords)/sizeof(g_keywords[0]);
+  constexpr int g_keywordSlotCount = 512;
+  constexpr int g_maximumKeywordLength = 16;
+  constexpr int g_maximumRawStringDelimiterLength = 16;
+
+  /// Multipliers found by trying random ones until no two keywords share a slot
+  constexpr quint32 keywordHash(quint32 p_first, quint32 p_second, quint32 p_middle, quint32 p_last, quint32 p_length) {
+    return (p_first*0x7b7e8739u + p_second*0x482a9d6bu + p_middle*0x607b3999u + p_last*0x97e06397u + p_length*0x94222c59u) >> 23;
+  }
+
+  constexpr int keywordLength(char const* p_keyword) {
+    int length = 0;
+    while (p_keyword[length] != '\0') {
+      ++length;
+    }
+    return length;
+  }
+
+  struct KeywordTable {
+    /// Keyword index plus one, 0 for empty slots
+    quint8 keywordIds[g_keywordSlotCount];
+    bool collision;
+  };
+
+  constexpr KeywordTable makeKeywordTable() {
+    KeywordTable table = {};
+    for (int k = 0; k < g_keywordCount; ++k) {
+      char const* keyword = g_keywords[k];
+      int length = keywordLength(keyword);
+      quint32 slot = keywordHash(quint8(keyword[0]), quint8(keyword[1]), quint8(keyword[length/2]), quint8(keyword[length-1]), quint32(length));
+      if (table.keywordIds[slot] != 0) {
+        table.collision = true;
+      }
+      table.keywordIds[slot] = quint8(k+1);
+    }
+    return table;
+  }
+
+  constexpr KeywordTable g_keywordTable = makeKeywordTable();
+  static_assert(!g_keywordTable.collision, "Two keywords share a hash slot, keywordHash() needs new multipliers");
+
+  inline bool isDigit(QChar p_char) {
+    return p_char.unicode() >= '0' && p_char.unicode() <= '9';
+  }
+
+  inline bool isIdentifierStart(QChar p_char) {
+    ushort code = p_char.unicode();
+    return (code >= 'a' && code <= 'z') || (code >= 'A' && code <= 'Z') || code == '_' || (code > 0x7f && p_char.isLetter());
+  }
+
+  inline bool isIdentifierCharacter(QChar p_char) {
+    return isIdentifierStart(p_char) || isDigit(p_char);
+  }
+
+  bool wordIs(QChar const* p_word, int p_length, char const* p_ascii) {
+    for (int k = 0; k < p_length; ++k) {
+      if (p_ascii[k] == '\0' || p_word[k].unicode() != ushort(p_ascii[k])) {
+        return false;
+      }
+    }
+    return p_ascii[p_length] == '\0';
+  }
+
+  /// Index after the closing quote, -1 if the line ends first
+  int findQuoteEnd(QChar const* p_text, int p_position, int p_length, ushort p_quote) {
+    while (p_position < p_length) {
+      ushort code = p_text[p_position].unicode();
+      if (code == '\\') {
+        p_position += 2;
+      } else if (code == p_quote) {
+        return p_position+1;
+      } else {
+        ++p_position;
+      }
+    }
+    return -1;
+  }
+
+  /// Index after the closing */, -1 if the line ends first
+  int findCommentEnd(QChar const* p_text, int p_position, int p_length) {
+    for (; p_position+1 < p_length; ++p_position) {
+      if (p_text[p_position].unicode() == '*' && p_text[p_position+1].unicode() == '/') {
+        return p_position+2;
+      }
+    }
+    return -1;
+  }
+
+  /// Index after the )delimiter" closing a raw string, -1 if the line ends first.
+  /// The delimiter is not kept from one line to the next, any one is accepted.
+  int findRawStringEnd(QChar const* p_text, int p_position, int p_length) {
+    for (; p_position < p_length; ++p_position) {
+      if (p_text[p_position].unicode() != ')') {
+        continue;
+      }
+      int end = p_position+1;
+      while (end < p_length && end-p_position <= g_maximumRawStringDelimiterLength && isIdentifierCharacter(p_text[end])) {
+        ++end;
+      }
+      if (end < p_length && p_text[end].unicode() == '"') {
+        return end+1;
+      }
+    }
+    return -1;
+  }
+
+  /// Q followed by letters and digits is a class, by capitals, digits and underscores a macro
+  bool qtIdentifierKind(QChar const* p_word, int p_length, CppLexer::TokenKind& p_kind) {
+    if (p_length < 2 || p_word[0].unicode() != 'Q') {
+      return false;
+    }
+
+    bool className = isIdentifierStart(p_word[1]) && p_word[1].unicode() != '_';
+    bool macroName = true;
+    for (int k = 1; k < p_length; ++k) {
+      ushort code = p_word[k].unicode();
+      bool capitalOrDigit = (code >= 'A' && code <= 'Z') || (code >= '0' && code <= '9');
+      className = className && code != '_';
+      macroName = macroName && (capitalOrDigit || code == '_');
+    }
+
+    if (className) {
+      p_kind = CppLexer::eQtClassToken;
+    } else if (macroName) {
+      p_kind = CppLexer::eQtMacroToken;
+    }
+    return className || macroName;
+  }
+
+  bool identifierKind(QChar const* p_word, int p_length, ushort p_following, ushort p_secondFollowing, CppLexer::TokenKind& p_kind) {
+    if (CppLexer::isKeyword(p_word, p_length)) {
+      p_kind = CppLexer::eKeywordToken;
+    } else if (wordIs(p_word, p_length, "Q_SIGNALS") || wordIs(p_word, p_length, "Q_SLOTS")) {
+      p_kind = CppLexer::eSignalSlotMacroToken;
+    } else if (qtIdentifierKind(p_word, p_length, p_kind)) {
+      return true;
+    } else if (wordIs(p_word, p_length, "q") || wordIs(p_word, p_length, "d")) {
+      p_kind = CppLexer::eQAndDPointerToken;
+    } else if (p_following == ':') {
+      // Scopes are followed by ::, labels and access specifiers by a single colon
+      p_kind = p_secondFollowing == ':' ? CppLexer::eScopeToken : CppLexer::eLabelToken;
+    } else {
+      return false;
+    }
+    return true;
+  }
+}
+
+/// Public
+
+int CppLexer::tokenize(QString const& p_line, int p_state, QVector<Token>& p_tokens) {
+  return tokenize(p_line.constData(), p_line.size(), p_state, p_tokens);
+}
+
+int CppLexer::tokenize(QChar const* p_text, int p_length, int p_state, QVector<Token>& p_tokens) {
+  QChar const* text = p_text;
+  int length = p_length;
+  int position = 0;
+
+  auto addToken = [&p_tokens](int p_start, int p_end, TokenKind p_kind) {
+    p_tokens << Token{p_start, p_end-p_start, p_kind};
+  };
+
+  // Constructs left open by the previous line
+  if (p_state == eCommentState || p_state == eStringState || p_state == eRawStringState) {
+    int end = -1;
+    TokenKind kind = eStringToken;
+    if (p_state == eCommentState) {
+      end = findCommentEnd(text, 0, length);
+      kind = eCommentToken;
+    } else if (p_state == eStringState) {
+      end = findQuoteEnd(text, 0, length, '"');
+    } else {
+      end = findRawStringEnd(text, 0, length);
+    }
+
+    if (end < 0) {
+      addToken(0, length, kind);
+      bool continued = p_state != eStringState || (length > 0 && text[length-1].unicode() == '\\');
+      return continued ? p_state : eCodeState;
+    }
+    addToken(0, end, kind);
+    position = end;
+  }
+
+  bool lineStart = position == 0;
+  while (position < length) {
+    QChar character = text[position];
+    ushort code = character.unicode();
+    ushort next = position+1 < length ? text[position+1].unicode() : 0;
+
+    if (code == ' ' || code == '\t') {
+      ++position;
+      continue;
+    }
+    bool directive = lineStart && code == '#';
+    lineStart = false;
+
+    // Comments
+    if (code == '/' && next == '/') {
+      addToken(position, length, eCommentToken);
+      return eCodeState;
+    }
+    if (code == '/' && next == '*') {
+      int end = findCommentEnd(text, position+2, length);
+      if (end < 0) {
+        addToken(position, length, eCommentToken);
+        return eCommentState;
+      }
+      addToken(position, end, eCommentToken);
+      position = end;
+      continue;
+    }
+
+    // String and character literals
+    if (code == '"' || code == '\'') {
+      int end = findQuoteEnd(text, position+1, length, code);
+      if (end < 0) {
+        addToken(position, length, eStringToken);
+        return code == '"' && text[length-1].unicode() == '\\' ? eStringState : eCodeState;
+      }
+      addToken(position, end, eStringToken);
+      position = end;
+      continue;
+    }
+
+    // Preprocessor directives
+    if (directive) {
+      int wordStart = position+1;
+      while (wordStart < length && (text[wordStart].unicode() == ' ' || text[wordStart].unicode() == '\t')) {
+        ++wordStart;
+      }
+      int wordEnd = wordStart;
+      while (wordEnd < length && isIdentifierCharacter(text[wordEnd])) {
+        ++wordEnd;
+      }
+
+      int end = wordEnd;
+      while (end < length && (text[end].unicode() == ' ' || text[end].unicode() == '\t')) {
+        ++end;
+      }
+      if (wordIs(text+wordStart, wordEnd-wordStart, "include") || wordIs(text+wordStart, wordEnd-wordStart, "include_next") || wordIs(text+wordStart, wordEnd-wordStart, "import")) {
+        if (end < length && (text[end].unicode() == '<' || text[end].unicode() == '"')) {
+          ushort close = text[end].unicode() == '<' ? '>' : '"';
+          ++end;
+          while (end < length && text[end].unicode() != close) {
+            ++end;
+          }
+          end = qMin(end+1, length);
+        } else {
+          end = wordEnd;
+        }
+        addToken(position, end, eIncludeToken);
+        position = end;
+        continue;
+      }
+
+      addToken(position, wordEnd, eDirectiveToken);
+      position = wordEnd;
+      if (wordIs(text+wordStart, wordEnd-wordStart, "define") && end < length && isIdentifierStart(text[end])) {
+        int nameEnd = end+1;
+        while (nameEnd < length && isIdentifierCharacter(text[nameEnd])) {
+          ++nameEnd;
+        }
+        addToken(end, nameEnd, eDefineToken);
+        position = nameEnd;
+      }
+      continue;
+    }
+
+    // Numbers, with suffixes, exponents and digit separators
+    if (isDigit(character) || (code == '.' && next >= '0' && next <= '9')) {
+      int end = position+1;
+      while (end < length) {
+        ushort numberCode = text[end].unicode();
+        ushort previousCode = text[end-1].unicode();
+        bool exponentSign = (numberCode == '+' || numberCode == '-') && (previousCode == 'e' || previousCode == 'E' || previousCode == 'p' || previousCode == 'P');
+        if (!isIdentifierCharacter(text[end]) && numberCode != '.' && numberCode != '\'' && !exponentSign) {
+          break;
+        }
+        ++end;
+      }
+      addToken(position, end, eNumberToken);
+      position = end;
+      continue;
+    }
+
+    // Identifiers, keywords and prefixed strings
+    if (isIdentifierStart(character)) {
+      int end = position+1;
+      while (end < length && isIdentifierCharacter(text[end])) {
+        ++end;
+      }
+      QChar const* word = text+position;
+      int wordLength = end-position;
+      ushort following = end < length ? text[end].unicode() : 0;
+      ushort secondFollowing = end+1 < length ? text[end+1].unicode() : 0;
+
+      if (following == '"') {
+        if (wordIs(word, wordLength, "R") || wordIs(word, wordLength, "LR") || wordIs(word, wordLength, "uR") || wordIs(word, wordLength, "UR") || wordIs(word, wordLength, "u8R")) {
+          int stringEnd = findRawStringEnd(text, end+1, length);
+          if (stringEnd < 0) {
+            addToken(position, length, eStringToken);
+            return eRawStringState;
+          }
+          addToken(position, stringEnd, eStringToken);
+          position = stringEnd;
+          continue;
+        }
+        if (wordIs(word, wordLength, "L") || wordIs(word, wordLength, "u") || wordIs(word, wordLength, "U") || wordIs(word, wordLength, "u8")) {
+          int stringEnd = findQuoteEnd(text, end+1, length, '"');
+          if (stringEnd < 0) {
+            addToken(position, length, eStringToken);
+            return text[length-1].unicode() == '\\' ? eStringState : eCodeState;
+          }
+          addToken(position, stringEnd, eStringToken);
+          position = stringEnd;
+          continue;
+        }
+      }
+
+      TokenKind kind = eKeywordToken;
+      if (identifierKind(word, wordLength, following, secondFollowing, kind)) {
+        addToken(position, end, kind);
+      }
+      position = end;
+      continue;
+    }
+
+    if (code == ':') {
+      int end = position+1;
+      while (end < length && text[end].unicode() == ':') {
+        ++end;
+      }
+      addToken(position, end, eColonToken);
+      position = end;
+      continue;
+    }
+
+    ++position;
+  }
+
+  return eCodeState;
+}
+
+bool CppLexer::isKeyword(QChar const* p_word, int p_length) {
+  if (p_length < 2 || p_length > g_maximumKeywordLength) {
+    return false;
+  }
+
+  quint32 slot = keywordHash(p_word[0].unicode(), p_word[1].unicode(), p_word[p_length/2].unicode(), p_word[p_length-1].unicode(), quint32(p_length));
+  int keywordId = g_keywordTable.keywordIds[slot];
+  return keywordId != 0 && wordIs(p_word, p_length, g_keywords[keywordId-1]);
+}
@@ -0,0 +1,56 @@
+#ifndef CPPLEXER_HXX
+#define CPPLEXER_HXX
+
+#include <QString>
+#include <QVector>
+#include <QMetaType>
+
+/// Hand-written lexer of C and C++ lines for syntax highlighting. A line is
+/// read once, character by character, and identifiers are checked against the
+/// keywords with a perfect hash computed at compile time. Comments, strings
+/// continued by a backslash and raw strings may span several lines, the state
+/// a line ends in is the one the next line starts in.
+class CppLexer {
+public:
+  enum TokenKind {
+    eKeywordToken = 0,
+    eQtClassToken,
+    eQtMacroToken,
+    eSignalSlotMacroToken,
+    eQAndDPointerToken,
+    eScopeToken,
+    eLabelToken,
+    eColonToken,
+    eNumberToken,
+    eStringToken,
+    eCommentToken,
+    eDirectiveToken,
+    eDefineToken,
+    eIncludeToken,
+    eTokenKindsCount
+  };
+
+  enum State {
+    eCodeState = 0,
+    eCommentState,
+    eStringState,
+    eRawStringState
+  };
+
+  struct Token {
+    int start;
+    int length;
+    TokenKind kind;
+  };
+
+  /// Appends the tokens of a line to p_tokens, returns the state the line ends in.
+  /// Negative states, as given for the first block of a document, are code.
+  static int tokenize(QString const& p_line, int p_state, QVector<Token>& p_tokens);
+  static int tokenize(QChar const* p_text, int p_length, int p_state, QVector<Token>& p_tokens);
+
+  static bool isKeyword(QChar const* p_word, int p_length);
+};
+
+Q_DECLARE_METATYPE(CppLexer::Token)
+
+#endif // CPPLEXER_HXX
@@ -0,0 +1,104 @@
+#include "DocumentCache.hxx"
+
+#include <QTextDocument>
+#include <QFileInfo>
+
+namespace {
+  int const g_maximumDocumentCount = 8;
+  /// In characters, laid out documents take several times more
+  qint64 const g_maximumDocumentsSize = 8*1024*1024;
+  int const g_maximumEntryCount = 32;
+  qint64 const g_maximumCompressedSize = 16*1024*1024;
+}
+
+DocumentCache::DocumentCache():
+  m_entries(),
+  m_order() {
+}
+
+DocumentCache::~DocumentCache() {
+  for (Entry const& entry: m_entries) {
+    delete entry.document;
+  }
+}
+
+/// Public
+
+void DocumentCache::insert(QString const& p_absoluteFilePath, Entry const& p_entry) {
+  remove(p_absoluteFilePath);
+  m_entries.insert(p_absoluteFilePath, p_entry);
+  m_order << p_absoluteFilePath;
+  trim();
+}
+
+bool DocumentCache::take(QString const& p_absoluteFilePath, Entry& p_entry) {
+  auto entry = m_entries.find(p_absoluteFilePath);
+  if (entry == m_entries.end()) {
+    return false;
+  }
+
+  QFileInfo fileInfo(p_absoluteFilePath);
+  if (fileInfo.lastModified() != entry->lastModified || fileInfo.size() != entry->size) {
+    remove(p_absoluteFilePath);
+    return false;
+  }
+
+  p_entry = *entry;
+  m_entries.erase(entry);
+  m_order.removeOne(p_absoluteFilePath);
+  return true;
+}
+
+
+/// Private
+
+void DocumentCache::trim() {
+  // The coldest laid out documents are compressed first, then the coldest entries dropped
+  int documentCount = 0;
+  qint64 documentsSize = 0;
+  qint64 compressedSize = 0;
+  for (Entry const& entry: m_entries) {
+    if (entry.document != nullptr) {
+      ++documentCount;
+      documentsSize += entry.document->characterCount();
+    }
+    compressedSize += entry.compressedContent.size();
+  }
+
+  for (QString const& absoluteFilePath: m_order) {
+    if (documentCount <= g_maximumDocumentCount && documentsSize <= g_maximumDocumentsSize) {
+      break;
+    }
+    Entry& entry = m_entries[absoluteFilePath];
+    if (entry.document == nullptr || absoluteFilePath == m_order.last()) {
+      continue;
+    }
+
+    --documentCount;
+    documentsSize -= entry.document->characterCount();
+    entry.compressedContent = qCompress(entry.content.toUtf8());
+    entry.content.clear();
+    entry.lineIndex.clear();
+    compressedSize += entry.compressedContent.size();
+    delete entry.document;
+    entry.document = nullptr;
+    entry.tokens = DocumentTokens();
+    entry.methods.clear();
+  }
+
+  while (m_order.size() > 1 && (m_order.size() > g_maximumEntryCount || compressedSize > g_maximumCompressedSize)) {
+    compressedSize -= m_entries.value(m_order.first()).compressedContent.size();
+    remove(m_order.first());
+  }
+}
+
+void DocumentCache::remove(QString const& p_absoluteFilePath) {
+  auto entry = m_entries.find(p_absoluteFilePath);
+  if (entry == m_entries.end()) {
+    return;
+  }
+
+  delete entry->document;
+  m_entries.erase(entry);
+  m_order.removeOne(p_absoluteFilePath);
+}
@@ -0,0 +1,60 @@
+#ifndef DOCUMENTCACHE_HXX
+#define DOCUMENTCACHE_HXX
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMap>
+#include <QByteArray>
+#include <QDateTime>
+
+#include "FileTypes.hxx"
+#include "DocumentTokens.hxx"
+#include "LineIndex.hxx"
+
+class QTextDocument;
+
+/// Documents of the files shown lately, least recently used evicted first.
+/// The most recent ones are kept laid out and highlighted, with their tokens
+/// and methods, to be set back in the editor as they are. Colder ones are
+/// only kept as compressed text once the laid out ones take too much memory,
+/// and are prepared again from it when shown.
+class DocumentCache {
+public:
+  struct Entry {
+    /// Laid out document, null once compressed
+    QTextDocument* document = nullptr;
+    /// Text of the document, compressed along with it
+    QString content;
+    LineIndex lineIndex;
+    QByteArray compressedContent;
+    FileTypes::FileType fileType = FileTypes::eOtherFile;
+    DocumentTokens tokens;
+    QMap<int, QString> methods;
+    /// Of the file when it was read, the entry is dropped once the file changes
+    QDateTime lastModified;
+    qint64 size = 0;
+    int cursorPosition = 0;
+    int verticalScrollValue = 0;
+  };
+
+  DocumentCache();
+  ~DocumentCache();
+
+  /// Takes ownership of the document of the entry
+  void insert(QString const& p_absoluteFilePath, Entry const& p_entry);
+  /// Removes the entry of a file unchanged since, the document is then the caller's
+  bool take(QString const& p_absoluteFilePath, Entry& p_entry);
+
+private:
+  Q_DISABLE_COPY(DocumentCache)
+
+  void trim();
+  void remove(QString const& p_absoluteFilePath);
+
+  QHash<QString, Entry> m_entries;
+  /// The least recently used first
+  QStringList m_order;
+};
+
+#endif // DOCUMENTCACHE_HXX
@@ -0,0 +1,39 @@
+#include "DocumentTokens.hxx"
+
+namespace {
+  int const g_linesPerCancellationCheck = 4096;
+}
+
+DocumentTokens::DocumentTokens():
+  m_tokens(),
+  m_lineTokenEnds(),
+  m_lineIndex() {
+}
+
+/// Public
+
+bool DocumentTokens::tokenize(QString const& p_content, LineIndex const& p_lineIndex, QAtomicInt const& p_currentGeneration, int p_generation) {
+  m_tokens.clear();
+  m_lineTokenEnds.clear();
+  m_lineIndex = p_lineIndex;
+
+  QChar const* text = p_content.constData();
+  int lineCount = m_lineIndex.lineCount();
+  m_lineTokenEnds.reserve(lineCount);
+  int state = CppLexer::eCodeState;
+  for (int line = 0; line < lineCount; ++line) {
+    if (line%g_linesPerCancellationCheck == 0 && p_currentGeneration.load() != p_generation) {
+      m_lineTokenEnds.clear();
+      return false;
+    }
+
+    // Lines but the last end with their line feed
+    int lineStart = m_lineIndex.lineStart(line);
+    int lineEnd = line+1 < lineCount ? m_lineIndex.lineStart(line+1)-1 : p_content.size();
+    state = CppLexer::tokenize(text+lineStart, lineEnd-lineStart, state, m_tokens);
+    m_lineTokenEnds << m_tokens.size();
+  }
+
+  m_tokens.squeeze();
+  return true;
+}
@@ -0,0 +1,41 @@
+#ifndef DOCUMENTTOKENS_HXX
+#define DOCUMENTTOKENS_HXX
+
+#include <QString>
+#include <QVector>
+#include <QAtomicInt>
+#include <QMetaType>
+
+#include "CppLexer.hxx"
+#include "LineIndex.hxx"
+
+/// Tokens of a whole document, lexed once when it is opened and shared by
+/// its consumers: the highlighter lays them out, and the outline parser skips
+/// comments, literals and directives through them.
+///
+/// Tokens of every line are kept in a single flat array, their starts
+/// relative to their line. Lines are those of the LineIndex of the editor,
+/// shared rather than scanned again. Copies are implicitly shared.
+class DocumentTokens {
+public:
+  DocumentTokens();
+
+  /// Lexes a text ending lines with line feeds along its lines, returns false if cancelled
+  bool tokenize(QString const& p_content, LineIndex const& p_lineIndex, QAtomicInt const& p_currentGeneration, int p_generation);
+
+  bool isEmpty() const { return m_lineTokenEnds.isEmpty(); }
+  int lineCount() const { return m_lineTokenEnds.size(); }
+  int lineStart(int p_line) const { return m_lineIndex.lineStart(p_line); }
+  int lineFirstToken(int p_line) const { return p_line == 0 ? 0 : m_lineTokenEnds.at(p_line-1); }
+  int lineTokenEnd(int p_line) const { return m_lineTokenEnds.at(p_line); }
+  CppLexer::Token const& token(int p_tokenId) const { return m_tokens.at(p_tokenId); }
+
+private:
+  QVector<CppLexer::Token> m_tokens;
+  QVector<int> m_lineTokenEnds;
+  LineIndex m_lineIndex;
+};
+
+Q_DECLARE_METATYPE(DocumentTokens)
+
+#endif // DOCUMENTTOKENS_HXX
@@ -0,0 +1,180 @@
+#include "FileLoader.hxx"
+
+#include <QRunnable>
+#include <QFile>
+#include <QFileInfo>
+
+#include "FileTypes.hxx"
+
+namespace {
+  int const g_cacheMaximumFileCount = 8;
+  /// In characters, about 32 MB
+  qint64 const g_cacheMaximumSize = 16*1024*1024;
+  /// Larger files are opened in the large file viewer, they are never cached
+  qint64 const g_maximumFileSize = 8*1024*1024;
+
+  char const* const g_companionSuffixes[] = {
+    ".h", "_p.h", ".hpp", ".hxx", ".cpp", ".cxx", ".cc", ".c", ".mm"
+  };
+}
+
+class FileLoaderWorker: public QRunnable {
+public:
+  FileLoaderWorker(FileLoader* p_loader, QString const& p_absoluteFilePath):
+    QRunnable(),
+    m_loader(p_loader),
+    m_absoluteFilePath(p_absoluteFilePath) {
+
+    setAutoDelete(true);
+  }
+
+  void run() override {
+    LoadedFile loadedFile;
+    loadedFile.absoluteFilePath = m_absoluteFilePath;
+    QFileInfo fileInfo(m_absoluteFilePath);
+    loadedFile.lastModified = fileInfo.lastModified();
+    loadedFile.size = fileInfo.size();
+
+    QString errorString;
+    loadedFile.succeeded = FileLoader::readFile(m_absoluteFilePath, loadedFile.content, errorString);
+    emit m_loader->fileRead(loadedFile, errorString);
+  }
+
+private:
+  FileLoader* m_loader;
+  QString m_absoluteFilePath;
+};
+
+
+FileLoader::FileLoader(QObject* p_parent):
+  QObject(p_parent),
+  m_threadPool(),
+  m_cache(),
+  m_cacheOrder(),
+  m_cacheSize(0),
+  m_pendingFilePaths(),
+  m_requestedFilePaths() {
+
+  m_threadPool.setMaxThreadCount(2);
+  qRegisterMetaType<LoadedFile>("LoadedFile");
+  connect(this, SIGNAL(fileRead(LoadedFile,QString)), this, SLOT(storeFile(LoadedFile,QString)), Qt::QueuedConnection);
+}
+
+FileLoader::~FileLoader() {
+  m_threadPool.clear();
+  m_threadPool.waitForDone();
+}
+
+/// Public
+
+bool FileLoader::readFile(QString const& p_absoluteFilePath, QString& p_content, QString& p_errorString) {
+  QFile file(p_absoluteFilePath);
+  if (!file.open(QIODevice::ReadOnly)) {
+    p_errorString = file.errorString();
+    p_content.clear();
+    return false;
+  }
+
+  // One read, one decoding, ASCII being the fast path of the UTF-8 decoder
+  p_content = QString::fromUtf8(file.readAll());
+  if (p_content.contains(QLatin1Char('\r'))) {
+    p_content.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+  }
+  if (!p_content.isEmpty() && !p_content.endsWith(QLatin1Char('\n'))) {
+    p_content.append(QLatin1Char('\n'));
+  }
+  return true;
+}
+
+QStringList FileLoader::companionFilePaths(QString const& p_absoluteFilePath) {
+  QStringList companionFilePaths;
+  if (!FileTypes::isCppCode(FileTypes::fileType(p_absoluteFilePath))) {
+    return companionFilePaths;
+  }
+
+  QFileInfo fileInfo(p_absoluteFilePath);
+  QString baseFilePath = fileInfo.absolutePath()+"/"+fileInfo.completeBaseName();
+  if (baseFilePath.endsWith("_p")) {
+    baseFilePath.chop(2);
+  }
+  for (char const* suffix: g_companionSuffixes) {
+    QString companionFilePath = baseFilePath+suffix;
+    if (companionFilePath != p_absoluteFilePath && QFileInfo::exists(companionFilePath)) {
+      companionFilePaths << companionFilePath;
+    }
+  }
+  return companionFilePaths;
+}
+
+bool FileLoader::cachedContent(QString const& p_absoluteFilePath, QString& p_content) {
+  auto loadedFile = m_cache.constFind(p_absoluteFilePath);
+  if (loadedFile == m_cache.constEnd()) {
+    return false;
+  }
+
+  // Files modified since they were read are read again
+  QFileInfo fileInfo(p_absoluteFilePath);
+  if (fileInfo.lastModified() != loadedFile->lastModified || fileInfo.size() != loadedFile->size) {
+    m_cacheSize -= loadedFile->content.size();
+    m_cache.remove(p_absoluteFilePath);
+    m_cacheOrder.removeOne(p_absoluteFilePath);
+    return false;
+  }
+
+  p_content = loadedFile->content;
+  m_cacheOrder.removeOne(p_absoluteFilePath);
+  m_cacheOrder << p_absoluteFilePath;
+  return true;
+}
+
+void FileLoader::load(QString const& p_absoluteFilePath) {
+  m_requestedFilePaths.insert(p_absoluteFilePath);
+  startWorker(p_absoluteFilePath);
+}
+
+void FileLoader::prefetch(QStringList const& p_absoluteFilePaths) {
+  for (QString const& absoluteFilePath: p_absoluteFilePaths) {
+    if (!m_cache.contains(absoluteFilePath) && QFileInfo(absoluteFilePath).size() <= g_maximumFileSize) {
+      startWorker(absoluteFilePath);
+    }
+  }
+}
+
+
+/// Private slots
+
+void FileLoader::storeFile(LoadedFile const& p_loadedFile, QString const& p_errorString) {
+  QString const& absoluteFilePath = p_loadedFile.absoluteFilePath;
+  m_pendingFilePaths.remove(absoluteFilePath);
+
+  if (p_loadedFile.succeeded && p_loadedFile.size <= g_maximumFileSize) {
+    if (m_cache.contains(absoluteFilePath)) {
+      m_cacheSize -= m_cache.value(absoluteFilePath).content.size();
+      m_cacheOrder.removeOne(absoluteFilePath);
+    }
+    m_cache.insert(absoluteFilePath, p_loadedFile);
+    m_cacheOrder << absoluteFilePath;
+    m_cacheSize += p_loadedFile.content.size();
+
+    while (m_cacheOrder.size() > g_cacheMaximumFileCount || (m_cacheSize > g_cacheMaximumSize && m_cacheOrder.size() > 1)) {
+      m_cacheSize -= m_cache.take(m_cacheOrder.takeFirst()).content.size();
+    }
+  }
+
+  if (m_requestedFilePaths.remove(absoluteFilePath)) {
+    emit fileLoaded(absoluteFilePath, p_loadedFile.content, p_loadedFile.succeeded, p_errorString);
+  }
+}
+
+
+/// Private
+
+void FileLoader::startWorker(QString const& p_absoluteFilePath) {
+  // A file being read already, prefetched or not, is not read twice
+  if (m_pendingFilePaths.contains(p_absoluteFilePath)) {
+    return;
+  }
+
+  m_pendingFilePaths.insert(p_absoluteFilePath);
+  m_threadPool.start(new FileLoaderWorker(this, p_absoluteFilePath));
+}
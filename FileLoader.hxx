@@ -0,0 +1,67 @@
+#ifndef FILELOADER_HXX
+#define FILELOADER_HXX
+
+#include <QObject>
+#include <QThreadPool>
+#include <QDateTime>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QMetaType>
+
+/// Content of a file read by a FileLoader worker.
+struct LoadedFile {
+  QString absoluteFilePath;
+  QString content;
+  QDateTime lastModified;
+  qint64 size = 0;
+  bool succeeded = false;
+};
+
+Q_DECLARE_METATYPE(LoadedFile)
+
+/// Reads source files on a worker thread, in one read decoded at once, and
+/// keeps the last ones read in a small cache. Files likely to be opened next,
+/// the header or the source of the one just opened, can be prefetched in the
+/// cache without being reported.
+class FileLoader: public QObject {
+  Q_OBJECT
+
+  friend class FileLoaderWorker;
+
+public:
+  explicit FileLoader(QObject* p_parent = nullptr);
+  ~FileLoader();
+
+  /// Reads a whole file with line feeds only, ending with one
+  static bool readFile(QString const& p_absoluteFilePath, QString& p_content, QString& p_errorString);
+  /// Existing sources and headers of the same name, "_p" suffix or not
+  static QStringList companionFilePaths(QString const& p_absoluteFilePath);
+
+  /// Content of a file read earlier and unchanged since, if any
+  bool cachedContent(QString const& p_absoluteFilePath, QString& p_content);
+  /// Reads a file in the background, fileLoaded is emitted once done
+  void load(QString const& p_absoluteFilePath);
+  /// Reads files in the background into the cache only
+  void prefetch(QStringList const& p_absoluteFilePaths);
+
+signals:
+  void fileLoaded(QString p_absoluteFilePath, QString p_content, bool p_succeeded, QString p_errorString);
+  void fileRead(LoadedFile p_loadedFile, QString p_errorString);
+
+private slots:
+  void storeFile(LoadedFile const& p_loadedFile, QString const& p_errorString);
+
+private:
+  void startWorker(QString const& p_absoluteFilePath);
+
+  QThreadPool m_threadPool;
+  QHash<QString, LoadedFile> m_cache;
+  /// Cached files, the least recently used first
+  QStringList m_cacheOrder;
+  qint64 m_cacheSize;
+  QSet<QString> m_pendingFilePaths;
+  QSet<QString> m_requestedFilePaths;
+};
+
+#endif // FILELOADER_HXX
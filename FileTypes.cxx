@@ -0,0 +1,92 @@
+#include "FileTypes.hxx"
+
+#include <QApplication>
+#include <QStyle>
+#include <QVector>
+
+namespace {
+  struct SuffixType {
+    QLatin1String suffix;
+    FileTypes::FileType fileType;
+    /// Part of the source index, the other types are only classified
+    bool indexed;
+  };
+
+  // Most frequent suffixes first
+  SuffixType const g_suffixTypes[] = {
+    {QLatin1String("cpp"), FileTypes::eCppFile, true},
+    {QLatin1String("h"), FileTypes::eHFile, true},
+    {QLatin1String("c"), FileTypes::eCFile, false},
+    {QLatin1String("cxx"), FileTypes::eCppFile, false},
+    {QLatin1String("cc"), FileTypes::eCppFile, false},
+    {QLatin1String("hxx"), FileTypes::eHFile, false},
+    {QLatin1String("hpp"), FileTypes::eHFile, false},
+    {QLatin1String("mm"), FileTypes::eObjectiveCppFile, false},
+    {QLatin1String("qml"), FileTypes::eQmlFile, false},
+    {QLatin1String("js"), FileTypes::eJsFile, false},
+    {QLatin1String("pro"), FileTypes::eProFile, false},
+    {QLatin1String("pri"), FileTypes::eProFile, false},
+    {QLatin1String("prf"), FileTypes::eProFile, false},
+    {QLatin1String("cmake"), FileTypes::eCMakeFile, false},
+    {QLatin1String("ui"), FileTypes::eUiFile, false},
+    {QLatin1String("qrc"), FileTypes::eQrcFile, false}
+  };
+
+  QLatin1String const g_cmakeListsFileName("CMakeLists.txt");
+  QLatin1String const g_privateHeaderSuffix("_p.h");
+}
+
+/// Public
+
+FileTypes::FileType FileTypes::fileType(QString const& p_fileName) {
+  int dotIndex = p_fileName.lastIndexOf('.');
+  if (dotIndex < 0) {
+    return eOtherFile;
+  }
+
+  QStringRef suffix = p_fileName.midRef(dotIndex+1);
+  for (SuffixType const& suffixType: g_suffixTypes) {
+    if (suffix == suffixType.suffix) {
+      if (suffixType.fileType == eHFile && p_fileName.endsWith(g_privateHeaderSuffix)) {
+        return ePrivateHFile;
+      }
+      return suffixType.fileType;
+    }
+  }
+
+  if (p_fileName == g_cmakeListsFileName) {
+    return eCMakeFile;
+  }
+  return eOtherFile;
+}
+
+QStringList FileTypes::nameFilters() {
+  QStringList nameFilters;
+  for (SuffixType const& suffixType: g_suffixTypes) {
+    if (suffixType.indexed) {
+      nameFilters << "*."+QString(suffixType.suffix);
+    }
+  }
+  return nameFilters;
+}
+
+QIcon const& FileTypes::icon(FileType p_fileType) {
+  static QVector<QIcon> icons;
+  if (icons.isEmpty()) {
+    QIcon cppFileIcon(":/icons/cppFile.png");
+    QIcon hFileIcon(":/icons/hFile.png");
+    QIcon otherFileIcon = QApplication::style()->standardIcon(QStyle::SP_FileIcon);
+
+    icons.fill(otherFileIcon, eFileTypesCount);
+    icons[eCppFile] = cppFileIcon;
+    icons[eCFile] = cppFileIcon;
+    icons[eObjectiveCppFile] = cppFileIcon;
+    icons[eHFile] = hFileIcon;
+    icons[ePrivateHFile] = hFileIcon;
+  }
+
+  if (p_fileType < 0 || p_fileType >= eFileTypesCount) {
+    return icons.at(eOtherFile);
+  }
+  return icons.at(p_fileType);
+}
@@ -0,0 +1,40 @@
+#ifndef FILETYPES_HXX
+#define FILETYPES_HXX
+
+#include <QString>
+#include <QStringList>
+#include <QIcon>
+
+/// File type classification shared by the index, the models, the menus and
+/// the editor. Types are told from a precomputed suffix table, and each type
+/// has one icon, embedded in the resources and built on first use only.
+class FileTypes {
+public:
+  enum FileType {
+    eOtherFile = 0,
+    eCppFile,
+    eHFile,
+    ePrivateHFile,
+    eCFile,
+    eObjectiveCppFile,
+    eQmlFile,
+    eJsFile,
+    eProFile,
+    eCMakeFile,
+    eUiFile,
+    eQrcFile,
+    eFileTypesCount
+  };
+
+  static FileType fileType(QString const& p_fileName);
+  static bool isHeader(FileType p_fileType) { return p_fileType == eHFile || p_fileType == ePrivateHFile; }
+  static bool isCppCode(FileType p_fileType) { return isHeader(p_fileType) || p_fileType == eCppFile || p_fileType == eCFile || p_fileType == eObjectiveCppFile; }
+
+  /// Name filters of the indexed types, C++ sources and headers, for the indexer, the watcher and the file system model
+  static QStringList nameFilters();
+
+  /// Decoration of the type, the same instance every time
+  static QIcon const& icon(FileType p_fileType);
+};
+
+#endif // FILETYPES_HXX
@@ -0,0 +1,121 @@
+#include "FindEngine.hxx"
+
+#include <QStringMatcher>
+#include <QRegularExpression>
+
+namespace {
+  inline bool isWordCharacter(QChar p_character) {
+    return p_character.isLetterOrNumber() || p_character == QLatin1Char('_');
+  }
+}
+
+FindEngine::FindEngine():
+  m_text(),
+  m_literalQuery(),
+  m_literalCaseSensitivity(Qt::CaseSensitive),
+  m_literalStarts(),
+  m_matchStarts(),
+  m_matchLengths() {
+}
+
+/// Public
+
+void FindEngine::setText(QString const& p_text) {
+  clear();
+  m_text = p_text;
+}
+
+void FindEngine::clear() {
+  m_text.clear();
+  m_literalQuery.clear();
+  m_literalStarts.clear();
+  m_matchStarts.clear();
+  m_matchLengths.clear();
+}
+
+void FindEngine::find(QString const& p_query, bool p_regExp, Qt::CaseSensitivity p_caseSensitivity, bool p_wholeWord) {
+  m_matchStarts.clear();
+  m_matchLengths.clear();
+  if (p_query.isEmpty()) {
+    m_literalQuery.clear();
+    m_literalStarts.clear();
+    return;
+  }
+
+  if (p_regExp) {
+    findRegExp(p_query, p_caseSensitivity, p_wholeWord);
+    return;
+  }
+
+  findLiteral(p_query, p_caseSensitivity);
+  m_matchStarts.reserve(m_literalStarts.size());
+  for (int start: m_literalStarts) {
+    if (!p_wholeWord || isWholeWord(start, p_query.size())) {
+      m_matchStarts << start;
+    }
+  }
+  m_matchLengths.fill(p_query.size(), m_matchStarts.size());
+}
+
+
+/// Private
+
+void FindEngine::findLiteral(QString const& p_query, Qt::CaseSensitivity p_caseSensitivity) {
+  // Occurrences of a longer query start where those of its prefix started
+  bool narrowed = !m_literalQuery.isEmpty() && m_literalCaseSensitivity == p_caseSensitivity && p_query.startsWith(m_literalQuery, p_caseSensitivity);
+  m_literalQuery = p_query;
+  m_literalCaseSensitivity = p_caseSensitivity;
+
+  if (narrowed) {
+    int length = p_query.size();
+    int kept = 0;
+    for (int start: m_literalStarts) {
+      if (start+length <= m_text.size() && m_text.midRef(start, length).compare(p_query, p_caseSensitivity) == 0) {
+        m_literalStarts[kept++] = start;
+      }
+    }
+    m_literalStarts.resize(kept);
+    return;
+  }
+
+  m_literalStarts.clear();
+  QStringMatcher matcher(p_query, p_caseSensitivity);
+  int start = matcher.indexIn(m_text);
+  while (start >= 0) {
+    m_literalStarts << start;
+    start = matcher.indexIn(m_text, start+1);
+  }
+}
+
+void FindEngine::findRegExp(QString const& p_query, Qt::CaseSensitivity p_caseSensitivity, bool p_wholeWord) {
+  // Regular expressions are not narrowed, a longer one may match where a shorter one did not
+  m_literalQuery.clear();
+  m_literalStarts.clear();
+
+  QString pattern = p_wholeWord ? "\\b(?:"+p_query+")\\b" : p_query;
+  QRegularExpression::PatternOptions options = QRegularExpression::MultilineOption;
+  if (p_caseSensitivity == Qt::CaseInsensitive) {
+    options |= QRegularExpression::CaseInsensitiveOption;
+  }
+  QRegularExpression regExp(pattern, options);
+  if (!regExp.isValid()) {
+    return;
+  }
+  regExp.optimize();
+
+  QRegularExpressionMatchIterator match = regExp.globalMatch(m_text);
+  while (match.hasNext()) {
+    QRegularExpressionMatch nextMatch = match.next();
+    if (nextMatch.capturedLength() > 0) {
+      m_matchStarts << nextMatch.capturedStart();
+      m_matchLengths << nextMatch.capturedLength();
+    }
+  }
+}
+
+bool FindEngine::isWholeWord(int p_start, int p_length) const {
+  int end = p_start+p_length;
+  bool wordBefore = p_start > 0 && isWordCharacter(m_text.at(p_start-1)) && isWordCharacter(m_text.at(p_start));
+  bool wordAfter = end < m_text.size() && isWordCharacter(m_text.at(end-1)) && isWordCharacter(m_text.at(end));
+  return !wordBefore && !wordAfter;
+}
@@ -0,0 +1,43 @@
+#ifndef FINDENGINE_HXX
+#define FINDENGINE_HXX
+
+#include <QString>
+#include <QVector>
+
+/// Finds every occurrence of a query in the text of a document, as start
+/// offsets and lengths, for the search bar of the source editor. Literal
+/// queries are searched with a precomputed Boyer-Moore matcher, regular
+/// expressions with a compiled QRegularExpression. A literal query typed on
+/// from the previous one only checks the previous occurrences again.
+class FindEngine {
+public:
+  FindEngine();
+
+  /// Starts over with another text, offsets are those of its characters
+  void setText(QString const& p_text);
+  void clear();
+
+  void find(QString const& p_query, bool p_regExp, Qt::CaseSensitivity p_caseSensitivity, bool p_wholeWord);
+
+  int matchCount() const { return m_matchStarts.size(); }
+  /// Increasing offsets
+  QVector<int> const& matchStarts() const { return m_matchStarts; }
+  QVector<int> const& matchLengths() const { return m_matchLengths; }
+
+private:
+  void findLiteral(QString const& p_query, Qt::CaseSensitivity p_caseSensitivity);
+  void findRegExp(QString const& p_query, Qt::CaseSensitivity p_caseSensitivity, bool p_wholeWord);
+  bool isWholeWord(int p_start, int p_length) const;
+
+  QString m_text;
+
+  /// Occurrences of the last literal query, whole words or not
+  QString m_literalQuery;
+  Qt::CaseSensitivity m_literalCaseSensitivity;
+  QVector<int> m_literalStarts;
+
+  QVector<int> m_matchStarts;
+  QVector<int> m_matchLengths;
+};
+
+#endif // FINDENGINE_HXX
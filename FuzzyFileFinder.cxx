@@ -0,0 +1,351 @@
+#include "FuzzyFileFinder.hxx"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+  ushort const g_prefixSentinel = 1;
+
+  int const g_contiguousScore = 1 << 20;
+  int const g_fuzzyScore = 1 << 16;
+  int const g_wordStartBonus = 8;
+  int const g_consecutiveBonus = 4;
+  int const g_cancellationCheckMask = 0xfff;
+
+  quint64 trigramKey(ushort p_first, ushort p_second, ushort p_third) {
+    return (quint64(p_first) << 32) | (quint64(p_second) << 16) | quint64(p_third);
+  }
+
+  quint64 characterMask(QString const& p_lowerText) {
+    quint64 mask = 0;
+    for (QChar character: p_lowerText) {
+      ushort code = character.unicode();
+      if (code >= 'a' && code <= 'z') {
+        mask |= quint64(1) << (code-'a');
+      } else if (code >= '0' && code <= '9') {
+        mask |= quint64(1) << (26+code-'0');
+      } else {
+        mask |= quint64(1) << (36+code%28);
+      }
+    }
+    return mask;
+  }
+
+  bool isWordStart(QString const& p_text, int p_position) {
+    if (p_position == 0) {
+      return true;
+    }
+    QChar previous = p_text.at(p_position-1);
+    return !previous.isLetterOrNumber() || (previous.isLower() && p_text.at(p_position).isUpper());
+  }
+}
+
+FuzzyFileFinder::FuzzyFileFinder():
+  m_lowerNames(),
+  m_nameMasks(),
+  m_trigramNames(),
+  m_directoryPaths(),
+  m_lowerDirectoryPaths(),
+  m_nameScores(),
+  m_matchedNameIds(),
+  m_lastNameQuery(),
+  m_lastNameQueryComplete(false) {
+}
+
+/// Public
+
+void FuzzyFileFinder::clear() {
+  m_lowerNames.clear();
+  m_nameMasks.clear();
+  m_trigramNames.clear();
+  m_directoryPaths.clear();
+  m_lowerDirectoryPaths.clear();
+  m_nameScores.clear();
+  m_matchedNameIds.clear();
+  m_lastNameQuery.clear();
+  m_lastNameQueryComplete = false;
+}
+
+QVector<int> FuzzyFileFinder::search(SourceIndex const& p_sourceIndex, QString const& p_query, int p_maximumResultCount, QAtomicInt const& p_currentGeneration, int p_generation) {
+  updateIndex(p_sourceIndex);
+
+  QString lowerQuery = p_query.trimmed().toLower();
+  QString lowerNameQuery = nameQuery(lowerQuery);
+  QString lowerDirectoryQuery = lowerQuery.left(qMax(0, lowerQuery.lastIndexOf('/')));
+  if (lowerNameQuery.isEmpty() && lowerDirectoryQuery.isEmpty()) {
+    return QVector<int>();
+  }
+
+  // Score names, -2 when not evaluated and -1 when not matching
+  if (!lowerNameQuery.isEmpty()) {
+    QVector<int> previousMatchedNameIds;
+    previousMatchedNameIds.swap(m_matchedNameIds);
+    m_nameScores.fill(-2, m_lowerNames.size());
+
+    if (m_lastNameQueryComplete && !m_lastNameQuery.isEmpty() && lowerNameQuery.startsWith(m_lastNameQuery)) {
+      // An extended query can only match names that matched before
+      for (int nameId: previousMatchedNameIds) {
+        scoreName(p_sourceIndex, nameId, lowerNameQuery);
+      }
+    } else {
+      // Contiguous matches from the trigram index first
+      for (int nameId: lookUp(lowerNameQuery)) {
+        scoreName(p_sourceIndex, nameId, lowerNameQuery);
+      }
+
+      // Fuzzy matches when there are not enough results yet, names missing a query character are skipped with their mask
+      m_lastNameQueryComplete = !lowerDirectoryQuery.isEmpty() || m_matchedNameIds.size() < p_maximumResultCount;
+      if (m_lastNameQueryComplete) {
+        quint64 queryMask = characterMask(lowerNameQuery);
+        for (int nameId = 0; nameId < m_lowerNames.size(); ++nameId) {
+          if ((nameId & g_cancellationCheckMask) == 0 && p_currentGeneration.load() != p_generation) {
+            // Scores are incomplete, the next query cannot be narrowed from them
+            m_lastNameQuery.clear();
+            m_matchedNameIds.clear();
+            return QVector<int>();
+          }
+          if (m_nameScores.at(nameId) == -2 && (m_nameMasks.at(nameId) & queryMask) == queryMask) {
+            scoreName(p_sourceIndex, nameId, lowerNameQuery);
+          }
+        }
+      }
+    }
+    m_lastNameQuery = lowerNameQuery;
+  }
+
+  // Score directories
+  QVector<int> directoryScores;
+  if (!lowerDirectoryQuery.isEmpty()) {
+    directoryScores.fill(-1, m_lowerDirectoryPaths.size());
+    for (int directoryId = 0; directoryId < m_lowerDirectoryPaths.size(); ++directoryId) {
+      if (!p_sourceIndex.isDirectoryRemoved(directoryId)) {
+        directoryScores[directoryId] = match(m_directoryPaths.at(directoryId), m_lowerDirectoryPaths.at(directoryId), lowerDirectoryQuery, nullptr);
+      }
+    }
+  }
+
+  QVector<Match> matches;
+  for (int fileId = 0; fileId < p_sourceIndex.fileCount(); ++fileId) {
+    if ((fileId & g_cancellationCheckMask) == 0 && p_currentGeneration.load() != p_generation) {
+      return QVector<int>();
+    }
+
+    int score = 0;
+    if (!lowerNameQuery.isEmpty()) {
+      score = m_nameScores.at(p_sourceIndex.fileNameId(fileId));
+      if (score < 0) {
+        continue;
+      }
+    }
+    if (!lowerDirectoryQuery.isEmpty()) {
+      int directoryScore = directoryScores.at(p_sourceIndex.fileDirectory(fileId));
+      if (directoryScore < 0) {
+        continue;
+      }
+      score += directoryScore;
+    }
+    matches << Match{fileId, score};
+  }
+
+  // Best first, then alphabetically
+  int resultCount = qMin(p_maximumResultCount, matches.size());
+  std::partial_sort(matches.begin(), matches.begin()+resultCount, matches.end(), [this, &p_sourceIndex](Match const& p_first, Match const& p_second) {
+    if (p_first.score != p_second.score) {
+      return p_first.score > p_second.score;
+    }
+    QString const& firstName = m_lowerNames.at(p_sourceIndex.fileNameId(p_first.fileId));
+    QString const& secondName = m_lowerNames.at(p_sourceIndex.fileNameId(p_second.fileId));
+    if (firstName != secondName) {
+      return firstName < secondName;
+    }
+    return p_first.fileId < p_second.fileId;
+  });
+
+  QVector<int> fileIds;
+  fileIds.reserve(resultCount);
+  for (int k = 0; k < resultCount; ++k) {
+    fileIds << matches.at(k).fileId;
+  }
+  return fileIds;
+}
+
+QVector<int> FuzzyFileFinder::matchSpans(QString const& p_fileName, QString const& p_query) {
+  QVector<int> spans;
+  QString lowerNameQuery = nameQuery(p_query.trimmed().toLower());
+  if (!lowerNameQuery.isEmpty()) {
+    match(p_fileName, p_fileName.toLower(), lowerNameQuery, &spans);
+  }
+  return spans;
+}
+
+
+/// Private
+
+void FuzzyFileFinder::updateIndex(SourceIndex const& p_sourceIndex) {
+  if (m_lowerNames.size() < p_sourceIndex.nameCount()) {
+    // New names have not been scored against the previous query
+    m_lastNameQuery.clear();
+    m_matchedNameIds.clear();
+  }
+
+  for (int nameId = m_lowerNames.size(); nameId < p_sourceIndex.nameCount(); ++nameId) {
+    QString lowerName = p_sourceIndex.name(nameId).toLower();
+    m_lowerNames << lowerName;
+    m_nameMasks << characterMask(lowerName);
+
+    // The first trigram starts with the sentinel, it indexes the two first characters
+    ushort first = g_prefixSentinel;
+    ushort second = lowerName.isEmpty() ? 0 : lowerName.at(0).unicode();
+    for (int k = 1; k < lowerName.size(); ++k) {
+      ushort third = lowerName.at(k).unicode();
+      addTrigram(trigramKey(first, second, third), nameId);
+      first = second;
+      second = third;
+    }
+  }
+
+  int rootDirectoryNameSize = p_sourceIndex.rootDirectoryName().size();
+  for (int directoryId = m_directoryPaths.size(); directoryId < p_sourceIndex.directoryCount(); ++directoryId) {
+    QString relativePath = p_sourceIndex.directoryPath(directoryId).mid(rootDirectoryNameSize+1);
+    m_directoryPaths << relativePath;
+    m_lowerDirectoryPaths << relativePath.toLower();
+  }
+}
+
+void FuzzyFileFinder::addTrigram(quint64 p_trigram, int p_nameId) {
+  // Names are indexed in id order, so posting lists stay sorted
+  QVector<int>& nameIds = m_trigramNames[p_trigram];
+  if (nameIds.isEmpty() || nameIds.last() != p_nameId) {
+    nameIds << p_nameId;
+  }
+}
+
+QVector<int> FuzzyFileFinder::lookUp(QString const& p_lowerQuery) const {
+  QVector<quint64> trigrams;
+  if (p_lowerQuery.size() == 2) {
+    trigrams << trigramKey(g_prefixSentinel, p_lowerQuery.at(0).unicode(), p_lowerQuery.at(1).unicode());
+  } else {
+    for (int k = 2; k < p_lowerQuery.size(); ++k) {
+      trigrams << trigramKey(p_lowerQuery.at(k-2).unicode(), p_lowerQuery.at(k-1).unicode(), p_lowerQuery.at(k).unicode());
+    }
+  }
+  if (trigrams.isEmpty()) {
+    return QVector<int>();
+  }
+
+  QVector<QVector<int> const*> postings;
+  for (quint64 trigram: trigrams) {
+    auto nameIds = m_trigramNames.constFind(trigram);
+    if (nameIds == m_trigramNames.constEnd()) {
+      return QVector<int>();
+    }
+    postings << &nameIds.value();
+  }
+
+  // Intersect starting from the shortest list
+  std::sort(postings.begin(), postings.end(), [](QVector<int> const* p_first, QVector<int> const* p_second) {
+    return p_first->size() < p_second->size();
+  });
+  QVector<int> nameIds = *postings.first();
+  for (int k = 1; k < postings.size() && !nameIds.isEmpty(); ++k) {
+    QVector<int> intersection;
+    std::set_intersection(nameIds.constBegin(), nameIds.constEnd(), postings.at(k)->constBegin(), postings.at(k)->constEnd(), std::back_inserter(intersection));
+    nameIds.swap(intersection);
+  }
+  return nameIds;
+}
+
+void FuzzyFileFinder::scoreName(SourceIndex const& p_sourceIndex, int p_nameId, QString const& p_lowerQuery) {
+  int score = match(p_sourceIndex.name(p_nameId), m_lowerNames.at(p_nameId), p_lowerQuery, nullptr);
+  m_nameScores[p_nameId] = score;
+  if (score >= 0) {
+    m_matchedNameIds << p_nameId;
+  }
+}
+
+QString FuzzyFileFinder::nameQuery(QString const& p_lowerQuery) {
+  return p_lowerQuery.mid(p_lowerQuery.lastIndexOf('/')+1);
+}
+
+int FuzzyFileFinder::match(QString const& p_text, QString const& p_lowerText, QString const& p_lowerQuery, QVector<int>* p_spans) {
+  // Lower casing may change the length of a few characters, word starts are then taken from the lower case text
+  QString const& text = (p_text.size() == p_lowerText.size()) ? p_text : p_lowerText;
+
+  // Contiguous match, at a word start when there is one
+  int contiguousPosition = p_lowerText.indexOf(p_lowerQuery);
+  if (contiguousPosition >= 0) {
+    for (int position = contiguousPosition; position >= 0; position = p_lowerText.indexOf(p_lowerQuery, position+1)) {
+      if (isWordStart(text, position)) {
+        contiguousPosition = position;
+        break;
+      }
+    }
+
+    if (p_spans != nullptr) {
+      *p_spans << contiguousPosition << p_lowerQuery.size();
+    }
+    int score = g_contiguousScore-p_lowerText.size();
+    if (contiguousPosition == 0) {
+      score += 2*g_wordStartBonus;
+    } else if (isWordStart(text, contiguousPosition)) {
+      score += g_wordStartBonus;
+    }
+    return score;
+  }
+
+  // Query characters in order, jumping to word starts first as in "ssm" for "SourceSearchModel"
+  QVector<int> positions;
+  if (!matchCharacters(text, p_lowerText, p_lowerQuery, true, positions) && !matchCharacters(text, p_lowerText, p_lowerQuery, false, positions)) {
+    return -1;
+  }
+
+  int score = g_fuzzyScore-p_lowerText.size();
+  for (int k = 0; k < positions.size(); ++k) {
+    if (isWordStart(text, positions.at(k))) {
+      score += g_wordStartBonus;
+    }
+    if (k > 0) {
+      int gap = positions.at(k)-positions.at(k-1)-1;
+      score += (gap == 0) ? g_consecutiveBonus : -gap;
+    }
+  }
+
+  if (p_spans != nullptr) {
+    for (int k = 0; k < positions.size(); ++k) {
+      if (k > 0 && positions.at(k) == positions.at(k-1)+1) {
+        ++p_spans->last();
+      } else {
+        *p_spans << positions.at(k) << 1;
+      }
+    }
+  }
+  return score;
+}
+
+bool FuzzyFileFinder::matchCharacters(QString const& p_text, QString const& p_lowerText, QString const& p_lowerQuery, bool p_preferWordStarts, QVector<int>& p_positions) {
+  p_positions.clear();
+
+  int position = 0;
+  for (QChar queryCharacter: p_lowerQuery) {
+    int next = p_lowerText.indexOf(queryCharacter, position);
+    if (next < 0) {
+      return false;
+    }
+
+    // Unless it continues the current run, take the next word start holding the character
+    bool continuesRun = !p_positions.isEmpty() && next == p_positions.last()+1;
+    if (p_preferWordStarts && !continuesRun) {
+      int wordStart = next;
+      while (wordStart >= 0 && !isWordStart(p_text, wordStart)) {
+        wordStart = p_lowerText.indexOf(queryCharacter, wordStart+1);
+      }
+      if (wordStart >= 0) {
+        next = wordStart;
+      }
+    }
+
+    p_positions << next;
+    position = next+1;
+  }
+  return true;
+}
@@ -0,0 +1,63 @@
+#ifndef FUZZYFILEFINDER_HXX
+#define FUZZYFILEFINDER_HXX
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QAtomicInt>
+
+#include "SourceIndex.hxx"
+
+/// Ranked "open file" search over a SourceIndex. Interned file names are
+/// indexed by trigram, with a leading sentinel so that two characters queries
+/// hit name prefixes, and contiguous matches are looked up there first. Fuzzy
+/// matches, the query characters in order, only fill up the results when the
+/// index does not give enough of them. A query like "core/qstr" also matches
+/// "core" against the directory path relative to the root directory.
+///
+/// Searches are given copies of the same growing SourceIndex, its appended
+/// names are indexed lazily.
+class FuzzyFileFinder {
+public:
+  FuzzyFileFinder();
+
+  /// To call when the source index has been replaced
+  void clear();
+
+  /// Ids of the best matching files, best first. The search gives up, with no
+  /// result, as soon as p_currentGeneration is no longer p_generation.
+  QVector<int> search(SourceIndex const& p_sourceIndex, QString const& p_query, int p_maximumResultCount, QAtomicInt const& p_currentGeneration, int p_generation);
+
+  /// Matched ranges of the file name, as start and length pairs
+  static QVector<int> matchSpans(QString const& p_fileName, QString const& p_query);
+
+private:
+  struct Match {
+    int fileId;
+    int score;
+  };
+
+  void updateIndex(SourceIndex const& p_sourceIndex);
+  void addTrigram(quint64 p_trigram, int p_nameId);
+  QVector<int> lookUp(QString const& p_lowerQuery) const;
+  void scoreName(SourceIndex const& p_sourceIndex, int p_nameId, QString const& p_lowerQuery);
+
+  static QString nameQuery(QString const& p_lowerQuery);
+  static int match(QString const& p_text, QString const& p_lowerText, QString const& p_lowerQuery, QVector<int>* p_spans);
+  static bool matchCharacters(QString const& p_text, QString const& p_lowerText, QString const& p_lowerQuery, bool p_preferWordStarts, QVector<int>& p_positions);
+
+  // Lower case names and relative directory paths, by SourceIndex id
+  QVector<QString> m_lowerNames;
+  QVector<quint64> m_nameMasks;
+  QHash<quint64, QVector<int>> m_trigramNames;
+  QVector<QString> m_directoryPaths;
+  QVector<QString> m_lowerDirectoryPaths;
+
+  // Scores of the current query, and names matching the previous one to narrow it when extended
+  QVector<int> m_nameScores;
+  QVector<int> m_matchedNameIds;
+  QString m_lastNameQuery;
+  bool m_lastNameQueryComplete;
+};
+
+#endif // FUZZYFILEFINDER_HXX
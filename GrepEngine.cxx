@@ -0,0 +1,472 @@
+#include "GrepEngine.hxx"
+
+#include <QRunnable>
+#include <QThread>
+#include <QMutex>
+#include <QRegExp>
+#include <QFile>
+
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+
+namespace {
+  int const g_filesPerChunk = 32;
+  int const g_maximumMatchCount = 10000;
+  int const g_maximumLineLength = 300;
+  int const g_lineContextLength = 60;
+  qint64 const g_maximumFileSize = 32*1024*1024;
+  qint64 const g_binaryCheckLength = 1024;
+
+  char toLowerAscii(char p_byte) {
+    return (p_byte >= 'A' && p_byte <= 'Z') ? p_byte+('a'-'A') : p_byte;
+  }
+
+  bool isAsciiLetter(char p_byte) {
+    return toLowerAscii(p_byte) >= 'a' && toLowerAscii(p_byte) <= 'z';
+  }
+
+  int hexDigitsLength(QString const& p_regExp, int p_start, int p_maximumLength) {
+    int end = p_start;
+    while (end < p_regExp.size() && end-p_start < p_maximumLength && isxdigit(p_regExp.at(end).toLatin1())) {
+      ++end;
+    }
+    return end-p_start;
+  }
+
+  /// Length of the escape sequence at p_start, its character code included
+  int escapeLength(QString const& p_regExp, int p_start) {
+    if (p_start+1 >= p_regExp.size()) {
+      return 1;
+    }
+
+    QChar escaped = p_regExp.at(p_start+1);
+    if (escaped == 'x' || escaped == 'u') {
+      return 2+hexDigitsLength(p_regExp, p_start+2, 4);
+    }
+    if (escaped == '0') {
+      int end = p_start+2;
+      while (end < p_regExp.size() && end-p_start < 5 && p_regExp.at(end) >= '0' && p_regExp.at(end) <= '7') {
+        ++end;
+      }
+      return end-p_start;
+    }
+    return 2;
+  }
+
+  /// Position after the character class opening at p_start, a first ']' being a member of the class
+  int classEnd(QString const& p_regExp, int p_start) {
+    int k = p_start+1;
+    if (k < p_regExp.size() && p_regExp.at(k) == '^') {
+      ++k;
+    }
+    if (k < p_regExp.size() && p_regExp.at(k) == ']') {
+      ++k;
+    }
+    while (k < p_regExp.size() && p_regExp.at(k) != ']') {
+      k += p_regExp.at(k) == '\\' ? escapeLength(p_regExp, k) : 1;
+    }
+    return qMin(k+1, p_regExp.size());
+  }
+
+  /// Position after the quantifier bounds opening at p_start, or after the brace alone if they are not bounds
+  int quantifierEnd(QString const& p_regExp, int p_start) {
+    int k = p_start+1;
+    while (k < p_regExp.size() && (p_regExp.at(k).isDigit() || p_regExp.at(k) == ',')) {
+      ++k;
+    }
+    return (k < p_regExp.size() && p_regExp.at(k) == '}') ? k+1 : p_start+1;
+  }
+
+  /// Finds a literal with memchr() on one of its bytes, preferably one without
+  /// case. Scans are remembered so that no byte of the file is scanned twice.
+  class LiteralFinder {
+  public:
+    LiteralFinder(QByteArray const& p_literal, bool p_caseInsensitive):
+      m_literal(p_literal),
+      m_caseInsensitive(p_caseInsensitive),
+      m_anchorOffset(0),
+      m_nextLowerAnchor(nullptr),
+      m_nextUpperAnchor(nullptr) {
+
+      if (m_caseInsensitive) {
+        for (int k = 0; k < m_literal.size(); ++k) {
+          if (!isAsciiLetter(m_literal.at(k))) {
+            m_anchorOffset = k;
+            break;
+          }
+        }
+      }
+    }
+
+    char const* find(char const* p_begin, char const* p_end) {
+      for (char const* position = p_begin+m_anchorOffset; position < p_end; ) {
+        char const* anchor = nextAnchor(position, p_end);
+        if (anchor == p_end) {
+          return nullptr;
+        }
+
+        char const* candidate = anchor-m_anchorOffset;
+        if (p_end-candidate >= m_literal.size() && matchesAt(candidate)) {
+          return candidate;
+        }
+        position = anchor+1;
+      }
+      return nullptr;
+    }
+
+  private:
+    char const* nextAnchor(char const* p_position, char const* p_end) {
+      char anchor = m_literal.at(m_anchorOffset);
+      if (!m_caseInsensitive || !isAsciiLetter(anchor)) {
+        return scan(m_nextLowerAnchor, anchor, p_position, p_end);
+      }
+      char const* lower = scan(m_nextLowerAnchor, anchor, p_position, p_end);
+      char const* upper = scan(m_nextUpperAnchor, anchor-('a'-'A'), p_position, p_end);
+      return qMin(lower, upper);
+    }
+
+    static char const* scan(char const*& p_next, char p_byte, char const* p_position, char const* p_end) {
+      if (p_next == nullptr || p_next < p_position) {
+        void const* found = std::memchr(p_position, p_byte, p_end-p_position);
+        p_next = found != nullptr ? static_cast<char const*>(found) : p_end;
+      }
+      return p_next;
+    }
+
+    bool matchesAt(char const* p_candidate) const {
+      if (!m_caseInsensitive) {
+        return std::memcmp(p_candidate, m_literal.constData(), m_literal.size()) == 0;
+      }
+      for (int k = 0; k < m_literal.size(); ++k) {
+        if (toLowerAscii(p_candidate[k]) != m_literal.at(k)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    QByteArray m_literal;
+    bool m_caseInsensitive;
+    int m_anchorOffset;
+    char const* m_nextLowerAnchor;
+    char const* m_nextUpperAnchor;
+  };
+
+  /// State shared by the workers of one search
+  struct GrepJob {
+    SourceIndex sourceIndex;
+    QSharedPointer<ContentIndex const> contentIndex;
+    QVector<quint32> trigrams;
+    QMutex plannedMutex;
+    bool planned;
+    QVector<int> fileIds;
+    int generation;
+    QRegExp regExp;
+    QByteArray literal;
+    bool caseInsensitiveLiteral;
+    QAtomicInt nextFileId;
+    QAtomicInt matchCount;
+    QAtomicInt truncated;
+    QAtomicInt runningWorkerCount;
+  };
+}
+
+class GrepWorker: public QRunnable {
+public:
+  GrepWorker(GrepEngine* p_engine, QSharedPointer<GrepJob> const& p_job):
+    QRunnable(),
+    m_engine(p_engine),
+    m_job(p_job) {
+
+    setAutoDelete(true);
+  }
+
+  void run() override {
+    // Matching state is kept by each copy of the regular expression
+    QRegExp regExp = m_job->regExp;
+    QVector<GrepMatch> matches;
+
+    planFiles();
+    int fileCount = m_job->fileIds.size();
+    while (!isStopped()) {
+      int firstFileId = m_job->nextFileId.fetchAndAddRelaxed(g_filesPerChunk);
+      if (firstFileId >= fileCount) {
+        break;
+      }
+
+      int lastFileId = qMin(firstFileId+g_filesPerChunk, fileCount);
+      for (int fileId = firstFileId; fileId < lastFileId && !isStopped(); ++fileId) {
+        grepFile(m_job->fileIds.at(fileId), regExp, matches);
+      }
+
+      if (!matches.isEmpty() && isCurrent()) {
+        emit m_engine->matchesFound(m_job->generation, matches);
+      }
+      matches.clear();
+    }
+
+    // The last worker to leave reports the end of the search
+    if (m_job->runningWorkerCount.fetchAndAddOrdered(-1) == 1 && isCurrent()) {
+      emit m_engine->searchFinished(m_job->generation, qMin(m_job->matchCount.load(), g_maximumMatchCount), fileCount, m_job->truncated.load() != 0);
+    }
+  }
+
+private:
+  bool isCurrent() const {
+    return m_engine->m_generation.load() == m_job->generation;
+  }
+
+  bool isStopped() const {
+    return !isCurrent() || m_job->truncated.load() != 0;
+  }
+
+  void planFiles() {
+    // The first worker narrows the files down, the others wait for it
+    QMutexLocker locker(&m_job->plannedMutex);
+    if (m_job->planned) {
+      return;
+    }
+    m_job->planned = true;
+
+    if (m_job->contentIndex.isNull() || isStopped()) {
+      m_job->fileIds.reserve(m_job->sourceIndex.fileCount());
+      for (int fileId = 0; fileId < m_job->sourceIndex.fileCount(); ++fileId) {
+        m_job->fileIds << fileId;
+      }
+      return;
+    }
+    m_job->fileIds = m_job->contentIndex->candidateFiles(m_job->sourceIndex, m_job->trigrams);
+  }
+
+  void grepFile(int p_fileId, QRegExp& p_regExp, QVector<GrepMatch>& p_matches) {
+    QString absoluteFilePath = m_job->sourceIndex.absoluteFilePath(p_fileId);
+    QFile file(absoluteFilePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+      return;
+    }
+    qint64 size = file.size();
+    if (size == 0 || size > g_maximumFileSize) {
+      return;
+    }
+
+    // Mapped files are read by the prefilter straight from the page cache
+    QByteArray content;
+    char const* data = reinterpret_cast<char const*>(file.map(0, size));
+    if (data == nullptr) {
+      content = file.readAll();
+      data = content.constData();
+      size = content.size();
+    }
+    if (std::memchr(data, '\0', qMin(size, g_binaryCheckLength)) != nullptr) {
+      return;
+    }
+
+    LiteralFinder literalFinder(m_job->literal, m_job->caseInsensitiveLiteral);
+    char const* end = data+size;
+    char const* position = data;
+    char const* countedPosition = data;
+    int lineNumber = 1;
+    while (position < end) {
+      // Lines are only decoded and matched where the literal is found
+      char const* candidate = position;
+      if (!m_job->literal.isEmpty()) {
+        candidate = literalFinder.find(position, end);
+        if (candidate == nullptr) {
+          break;
+        }
+      }
+
+      char const* lineStart = candidate;
+      while (lineStart > position && lineStart[-1] != '\n') {
+        --lineStart;
+      }
+      void const* newLine = std::memchr(candidate, '\n', end-candidate);
+      char const* lineEnd = newLine != nullptr ? static_cast<char const*>(newLine) : end;
+      position = lineEnd+1;
+
+      QString line = QString::fromUtf8(lineStart, lineEnd-lineStart);
+      int matchStart = p_regExp.indexIn(line);
+      if (matchStart < 0) {
+        continue;
+      }
+
+      if (m_job->matchCount.fetchAndAddRelaxed(1) >= g_maximumMatchCount) {
+        m_job->truncated.store(1);
+        return;
+      }
+
+      lineNumber += int(std::count(countedPosition, lineStart, '\n'));
+      countedPosition = lineStart;
+      p_matches << lineMatch(p_fileId, absoluteFilePath, lineNumber, line, matchStart, p_regExp.matchedLength());
+    }
+  }
+
+  GrepMatch lineMatch(int p_fileId, QString const& p_absoluteFilePath, int p_lineNumber, QString const& p_line, int p_matchStart, int p_matchLength) const {
+    // Lines are shown without their indentation, and long ones around the match only
+    int lineStart = 0;
+    while (lineStart < p_matchStart && p_line.at(lineStart).isSpace()) {
+      ++lineStart;
+    }
+    if (p_line.size()-lineStart > g_maximumLineLength) {
+      lineStart = qMax(lineStart, p_matchStart-g_lineContextLength);
+    }
+
+    GrepMatch match;
+    match.fileName = m_job->sourceIndex.fileName(p_fileId);
+    match.absoluteFilePath = p_absoluteFilePath;
+    match.lineNumber = p_lineNumber;
+    match.line = p_line.mid(lineStart, g_maximumLineLength);
+    if (match.line.endsWith('\r')) {
+      match.line.chop(1);
+    }
+    match.matchStart = p_matchStart-lineStart;
+    match.matchLength = qMin(p_matchLength, match.line.size()-match.matchStart);
+    return match;
+  }
+
+  GrepEngine* m_engine;
+  QSharedPointer<GrepJob> m_job;
+};
+
+
+GrepEngine::GrepEngine(QObject* p_parent):
+  QObject(p_parent),
+  m_threadPool(),
+  m_generation(0) {
+
+  // Reading files is mostly waiting for the disk on a cold cache, every core gets a worker
+  m_threadPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+
+  qRegisterMetaType<GrepMatch>("GrepMatch");
+  qRegisterMetaType<QVector<GrepMatch>>("QVector<GrepMatch>");
+}
+
+GrepEngine::~GrepEngine() {
+  cancel();
+  m_threadPool.waitForDone();
+}
+
+/// Public
+
+int GrepEngine::search(SourceIndex const& p_sourceIndex, QSharedPointer<ContentIndex const> const& p_contentIndex, QString const& p_pattern, bool p_regExp, Qt::CaseSensitivity p_caseSensitivity) {
+  int generation = m_generation.fetchAndAddOrdered(1)+1;
+  m_threadPool.clear();
+
+  QSharedPointer<GrepJob> job(new GrepJob);
+  job->sourceIndex = p_sourceIndex;
+  job->contentIndex = p_contentIndex;
+  job->trigrams = ContentIndex::queryTrigrams(p_regExp ? requiredLiterals(p_pattern) : QStringList(p_pattern), p_caseSensitivity);
+  job->planned = false;
+  job->generation = generation;
+  job->regExp = QRegExp(p_pattern, p_caseSensitivity, p_regExp ? QRegExp::RegExp : QRegExp::FixedString);
+
+  // The prefilter compares bytes, case is only folded for ASCII literals
+  QString literal = p_regExp ? requiredLiteral(p_pattern) : p_pattern;
+  bool asciiLiteral = std::all_of(literal.cbegin(), literal.cend(), [](QChar p_char) { return p_char.unicode() < 0x80; });
+  job->caseInsensitiveLiteral = p_caseSensitivity == Qt::CaseInsensitive;
+  if (!job->caseInsensitiveLiteral) {
+    job->literal = literal.toUtf8();
+  } else if (asciiLiteral) {
+    job->literal = literal.toLower().toUtf8();
+  }
+
+  int workerCount = m_threadPool.maxThreadCount();
+  job->runningWorkerCount.store(workerCount);
+  for (int k = 0; k < workerCount; ++k) {
+    m_threadPool.start(new GrepWorker(this, job));
+  }
+  return generation;
+}
+
+void GrepEngine::cancel() {
+  m_generation.fetchAndAddOrdered(1);
+  m_threadPool.clear();
+}
+
+QStringList GrepEngine::requiredLiterals(QString const& p_regExp) {
+  // Any alternative may lack the literals of another
+  QStringList literals;
+  if (p_regExp.contains('|')) {
+    return literals;
+  }
+
+  QString literal;
+  int groupDepth = 0;
+  auto endLiteral = [&]() {
+    if (!literal.isEmpty()) {
+      literals << literal;
+    }
+    literal.clear();
+  };
+
+  int k = 0;
+  while (k < p_regExp.size()) {
+    QChar character = p_regExp.at(k);
+    int characterLength = 1;
+
+    if (character == '\\') {
+      // Escaped punctuation is literal, escaped letters and digits are classes, references or character codes
+      if (k+1 >= p_regExp.size() || p_regExp.at(k+1).isLetterOrNumber()) {
+        endLiteral();
+        k += escapeLength(p_regExp, k);
+        continue;
+      }
+      character = p_regExp.at(k+1);
+      characterLength = 2;
+    } else if (character == '[') {
+      endLiteral();
+      k = classEnd(p_regExp, k);
+      continue;
+    } else if (character == '(' || character == ')') {
+      // Inline options such as (?i) change how the characters after them match, the whole tree is read
+      if (character == '(' && k+1 < p_regExp.size() && p_regExp.at(k+1) == '?') {
+        return QStringList();
+      }
+
+      // Groups may be optional or repeated, only top level characters are kept
+      endLiteral();
+      groupDepth += character == '(' ? 1 : -1;
+      ++k;
+      continue;
+    } else if (character == '{') {
+      // Bounds of a quantifier, the atom before it was left out of the literal already
+      endLiteral();
+      k = quantifierEnd(p_regExp, k);
+      continue;
+    } else if (QString("^$.*+?}").contains(character)) {
+      endLiteral();
+      ++k;
+      continue;
+    }
+
+    k += characterLength;
+    if (groupDepth > 0) {
+      continue;
+    }
+
+    // An optional character ends the literal before it, a repeated one right after it
+    QChar quantifier = k < p_regExp.size() ? p_regExp.at(k) : QChar();
+    if (quantifier == '?' || quantifier == '*' || quantifier == '{') {
+      endLiteral();
+    } else if (quantifier == '+') {
+      literal += character;
+      endLiteral();
+    } else {
+      literal += character;
+    }
+  }
+  endLiteral();
+
+  return literals;
+}
+
+QString GrepEngine::requiredLiteral(QString const& p_regExp) {
+  QString longestLiteral;
+  for (QString const& literal: requiredLiterals(p_regExp)) {
+    if (literal.size() > longestLiteral.size()) {
+      longestLiteral = literal;
+    }
+  }
+  return longestLiteral;
+}
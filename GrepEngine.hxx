@@ -0,0 +1,59 @@
+#ifndef GREPENGINE_HXX
+#define GREPENGINE_HXX
+
+#include <QObject>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QMetaType>
+#include <QSharedPointer>
+
+#include "SourceIndex.hxx"
+#include "ContentIndex.hxx"
+
+/// Line of a source file matching a grep pattern.
+struct GrepMatch {
+  QString fileName;
+  QString absoluteFilePath;
+  int lineNumber;
+  QString line;
+  int matchStart;
+  int matchLength;
+};
+
+Q_DECLARE_METATYPE(GrepMatch)
+
+/// Searches the content of every indexed file, on as many worker threads as
+/// there are cores. When a content index is given, only the files holding
+/// every trigram of the pattern literals are read. Files are memory mapped
+/// and scanned for the pattern literal with memchr() before any line is
+/// decoded or matched, and matches are reported by small batches while the
+/// search goes on. As for file name searches, a new search cancels the
+/// previous one.
+class GrepEngine: public QObject {
+  Q_OBJECT
+
+  friend class GrepWorker;
+
+public:
+  explicit GrepEngine(QObject* p_parent = nullptr);
+  ~GrepEngine();
+
+  /// Starts searching, returns the generation reported with the matches
+  int search(SourceIndex const& p_sourceIndex, QSharedPointer<ContentIndex const> const& p_contentIndex, QString const& p_pattern, bool p_regExp, Qt::CaseSensitivity p_caseSensitivity);
+  void cancel();
+
+  /// Literals every match of the regular expression contains, none if it sets inline options
+  static QStringList requiredLiterals(QString const& p_regExp);
+  /// Longest of them, empty if unknown
+  static QString requiredLiteral(QString const& p_regExp);
+
+signals:
+  void matchesFound(int p_generation, QVector<GrepMatch> p_matches);
+  void searchFinished(int p_generation, int p_matchCount, int p_searchedFileCount, bool p_truncated);
+
+private:
+  QThreadPool m_threadPool;
+  QAtomicInt m_generation;
+};
+
+#endif // GREPENGINE_HXX
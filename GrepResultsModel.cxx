@@ -0,0 +1,195 @@
+#include "GrepResultsModel.hxx"
+
+#include <QRegExp>
+
+namespace {
+  int const g_grepDelayMs = 300;
+  int const g_minimumPatternLength = 2;
+  /// Changed files are collected in memory until they are this part of the tree
+  int const g_maximumUpdatedFilesPercent = 25;
+}
+
+GrepResultsModel::GrepResultsModel(SourceIndex const* p_sourceIndex, QObject* p_parent):
+  QAbstractListModel(p_parent),
+  m_sourceIndex(p_sourceIndex),
+  m_grepEngine(nullptr),
+  m_grepTimer(),
+  m_contentIndex(),
+  m_contentIndexBuilder(nullptr),
+  m_pattern(),
+  m_regExp(false),
+  m_grepGeneration(-1),
+  m_matches() {
+
+  m_grepEngine = new GrepEngine(this);
+  connect(m_grepEngine, SIGNAL(matchesFound(int,QVector<GrepMatch>)), this, SLOT(appendMatches(int,QVector<GrepMatch>)));
+  connect(m_grepEngine, SIGNAL(searchFinished(int,int,int,bool)), this, SLOT(endGrep(int)));
+
+  m_contentIndexBuilder = new ContentIndexBuilder(this);
+  connect(m_contentIndexBuilder, SIGNAL(buildFinished(QString,bool)), this, SLOT(reloadContentIndex(QString,bool)));
+  connect(m_contentIndexBuilder, SIGNAL(updateFinished(QSharedPointer<ContentIndex const>)), this, SLOT(setContentIndex(QSharedPointer<ContentIndex const>)));
+
+  // Reading the whole tree is much longer than a file name search, typing has to pause longer
+  m_grepTimer.setSingleShot(true);
+  m_grepTimer.setInterval(g_grepDelayMs);
+  connect(&m_grepTimer, SIGNAL(timeout()), this, SLOT(startGrep()));
+}
+
+/// Public
+
+int GrepResultsModel::rowCount(QModelIndex const& p_parent) const {
+  if (p_parent.isValid()) {
+    return 0;
+  }
+  return m_matches.size();
+}
+
+QVariant GrepResultsModel::data(QModelIndex const& p_index, int p_role) const {
+  if (!p_index.isValid() || p_index.row() >= m_matches.size()) {
+    return QVariant();
+  }
+
+  GrepMatch const& match = m_matches.at(p_index.row());
+  switch (p_role) {
+  case Qt::DisplayRole: {
+    return displayedText(match);
+  }
+  case Qt::ToolTipRole: {
+    return match.absoluteFilePath;
+  }
+  case Qt::DecorationRole: {
+    return FileTypes::icon(FileTypes::fileType(match.fileName));
+  }
+  case MatchSpansRole: {
+    int prefixLength = displayedText(match).size()-match.line.size();
+    return QVariantList() << prefixLength+match.matchStart << match.matchLength;
+  }
+  case FileNameRole: {
+    return match.fileName;
+  }
+  case LineNumberRole: {
+    return match.lineNumber;
+  }
+  default: {
+    return QVariant();
+  }
+  }
+}
+
+Qt::ItemFlags GrepResultsModel::flags(QModelIndex const& p_index) const {
+  if (!p_index.isValid()) {
+    return Qt::NoItemFlags;
+  }
+  return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+
+void GrepResultsModel::setPattern(QString const& p_pattern, bool p_regExp) {
+  if (p_pattern == m_pattern && p_regExp == m_regExp) {
+    return;
+  }
+  m_pattern = p_pattern;
+  m_regExp = p_regExp;
+  m_grepTimer.start();
+}
+
+void GrepResultsModel::clear() {
+  m_grepTimer.stop();
+  m_grepEngine->cancel();
+  m_grepGeneration = -1;
+  m_pattern.clear();
+
+  beginResetModel();
+  m_matches.clear();
+  endResetModel();
+}
+
+void GrepResultsModel::loadContentIndex() {
+  QSharedPointer<ContentIndex> contentIndex(new ContentIndex);
+  if (contentIndex->load(ContentIndex::defaultFileName(), m_sourceIndex->rootDirectoryName())) {
+    m_contentIndex = contentIndex;
+  } else {
+    m_contentIndex.reset();
+  }
+}
+
+void GrepResultsModel::updateContentIndex() {
+  if (m_contentIndexBuilder->isRunning()) {
+    return;
+  }
+
+  // Missing or indexed for another root directory
+  if (m_contentIndex.isNull()) {
+    m_contentIndexBuilder->start(*m_sourceIndex, ContentIndex::defaultFileName());
+    return;
+  }
+
+  // Unindexed files are read by every grep, only the changed ones are read to collect their trigrams
+  // until they make up so much of the tree that indexing it again is worth it
+  int unindexedFileCount = m_contentIndex->unindexedFileCount(*m_sourceIndex);
+  if (unindexedFileCount == 0) {
+    return;
+  }
+  if (qint64(m_contentIndex->updatedFileCount()+unindexedFileCount)*100 > qint64(m_sourceIndex->fileCount())*g_maximumUpdatedFilesPercent) {
+    m_contentIndexBuilder->start(*m_sourceIndex, ContentIndex::defaultFileName());
+  } else {
+    m_contentIndexBuilder->update(m_contentIndex, *m_sourceIndex, ContentIndex::defaultFileName());
+  }
+}
+
+
+/// Private slots
+
+void GrepResultsModel::startGrep() {
+  m_grepEngine->cancel();
+  m_grepGeneration = -1;
+
+  beginResetModel();
+  m_matches.clear();
+  endResetModel();
+
+  if (m_pattern.size() < g_minimumPatternLength || (m_regExp && !QRegExp(m_pattern).isValid())) {
+    return;
+  }
+
+  m_grepGeneration = m_grepEngine->search(*m_sourceIndex, m_contentIndex, m_pattern, m_regExp, Qt::CaseInsensitive);
+}
+
+void GrepResultsModel::appendMatches(int p_generation, QVector<GrepMatch> const& p_matches) {
+  // Matches of a cancelled grep may still be queued
+  if (p_generation != m_grepGeneration || p_matches.isEmpty()) {
+    return;
+  }
+
+  beginInsertRows(QModelIndex(), m_matches.size(), m_matches.size()+p_matches.size()-1);
+  m_matches += p_matches;
+  endInsertRows();
+}
+
+void GrepResultsModel::endGrep(int p_generation) {
+  if (p_generation != m_grepGeneration) {
+    return;
+  }
+
+  m_grepGeneration = -1;
+}
+
+void GrepResultsModel::reloadContentIndex(QString const& p_fileName, bool p_built) {
+  Q_UNUSED(p_fileName)
+  // Running greps keep the index they started with
+  if (p_built) {
+    loadContentIndex();
+  }
+}
+
+
+void GrepResultsModel::setContentIndex(QSharedPointer<ContentIndex const> const& p_contentIndex) {
+  // Running greps keep the index they started with
+  m_contentIndex = p_contentIndex;
+}
+
+
+/// Private
+
+QString GrepResultsModel::displayedText(GrepMatch const& p_match) const {
+  return p_match.fileName+":"+QString::number(p_match.lineNumber)+": "+p_match.line;
+}
@@ -0,0 +1,67 @@
+#ifndef GREPRESULTSMODEL_HXX
+#define GREPRESULTSMODEL_HXX
+
+#include <QAbstractListModel>
+#include <QTimer>
+
+#include "SourceIndex.hxx"
+#include "GrepEngine.hxx"
+#include "ContentIndex.hxx"
+#include "ContentIndexBuilder.hxx"
+#include "SourceSearchModel.hxx"
+
+/// Lines of the indexed files matching a pattern, shown as file:line: text.
+/// Matches are appended as the grep engine reports them, so the first ones
+/// are usable long before the whole tree has been read.
+///
+/// The model also keeps the content index that narrows greps down, updates
+/// it in the background with the changed files, and rebuilds it once they
+/// make up too much of the tree.
+class GrepResultsModel: public QAbstractListModel {
+  Q_OBJECT
+
+public:
+  enum Roles {
+    /// Same role as the file search list, so that the same delegate draws both
+    MatchSpansRole = SourceSearchModel::MatchSpansRole,
+    FileNameRole,
+    LineNumberRole
+  };
+
+  explicit GrepResultsModel(SourceIndex const* p_sourceIndex, QObject* p_parent = nullptr);
+
+  int rowCount(QModelIndex const& p_parent = QModelIndex()) const override;
+  QVariant data(QModelIndex const& p_index, int p_role = Qt::DisplayRole) const override;
+  Qt::ItemFlags flags(QModelIndex const& p_index) const override;
+
+  /// Greps once typing pauses, short patterns are not searched
+  void setPattern(QString const& p_pattern, bool p_regExp);
+  void clear();
+
+  void loadContentIndex();
+  /// Updates the content index with the files added or modified since it was built, or rebuilds it if they are too many
+  void updateContentIndex();
+
+private slots:
+  void startGrep();
+  void appendMatches(int p_generation, QVector<GrepMatch> const& p_matches);
+  void endGrep(int p_generation);
+  void reloadContentIndex(QString const& p_fileName, bool p_built);
+  void setContentIndex(QSharedPointer<ContentIndex const> const& p_contentIndex);
+
+private:
+  QString displayedText(GrepMatch const& p_match) const;
+
+  SourceIndex const* m_sourceIndex;
+  GrepEngine* m_grepEngine;
+  QTimer m_grepTimer;
+  QSharedPointer<ContentIndex const> m_contentIndex;
+  ContentIndexBuilder* m_contentIndexBuilder;
+
+  QString m_pattern;
+  bool m_regExp;
+  int m_grepGeneration;
+  QVector<GrepMatch> m_matches;
+};
+
+#endif // GREPRESULTSMODEL_HXX
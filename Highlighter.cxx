@@ -40,148 +40,127 @@
 
 #include "Highlighter.hxx"
 
-#include <QApplication>
-
-Highlighter::Highlighter(QTextDocument* parent):
-  QSyntaxHighlighter(parent) {
-
-    HighlightingRule rule;
-
-    qmacroFormat.setForeground(Qt::darkBlue);
-    rule.pattern = QRegExp("\\bQ[A-Z0-9_]+\\b");
-    rule.format = qmacroFormat;
-    highlightingRules.append(rule);
-
-    labelFormat.setForeground(Qt::darkRed);
-    rule.pattern = QRegExp("[A-Za-z_]+:");
-    rule.format = labelFormat;
-    highlightingRules.append(rule);
-
-    noLabelFormat.setForeground(QColor("#444"));
-    rule.pattern = QRegExp("[A-Za-z_]+::");
-    rule.format = noLabelFormat;
-    highlightingRules.append(rule);
-
-    signalSlotMacroFormat.setForeground(Qt::darkMagenta);
-    rule.pattern = QRegExp("(public|protected|private)\\s+(Q_SIGNALS|Q_SLOTS)");
-    rule.format = signalSlotMacroFormat;
-    highlightingRules.append(rule);
-
-    keywordFormat.setForeground(Qt::darkYellow);
-    QStringList keywordPatterns;
-    keywordPatterns << "\\balignas\\b" << "\\balignof\\b" << "\\basm\\b"
-                    << "\\bauto\\b" << "\\bbool\\b" << "\\bbreak\\b"
-                    << "\\bcase\\b" << "\\bcatch\\b" << "\\bchar\\b"
-                    << "\\bchar16_t\\b" << "\\bchar32_t\\b" << "\\bclass\\b"
-                    << "\\bconst\\b" << "\\bconstexpr\\b" << "\\bcontinue\\b"
-                    << "\\bdecltype\\b" << "\\bdefault\\b" << "\\bdelete\\b"
-                    << "\\bdo\\b" << "\\bdouble\\b" << "\\bdynamic_cast\\b"
-                    << "\\belse\\b" << "\\bemit\\b" << "\\benum\\b"
-                    << "\\bexplicit\\b" << "\\bexport\\b" << "\\bextern\\b"
-                    << "\\bfalse\\b" << "\\bfloat\\b" << "\\bfor\\b"
-                    << "\\bforeach\\b" << "\\bforever\\b" << "\\bfriend\\b"
-                    << "\\bgoto\\b" << "\\bif\\b" << "\\binline\\b"
-                    << "\\bint\\b" << "\\blong\\b" << "\\bmutable\\b"
-                    << "\\bnamespace\\b" << "\\bnew\\b" << "\\bnoexcept\\b"
-                    << "\\bnullptr\\b" << "\\boperator\\b"<< "\\bprivate\\b"
-                    << "\\bprotected\\b" << "\\bpublic\\b" << "\\bregister\\b"
-                    << "\\breinterpret_cast\\b" << "\\breturn\\b"
-                    << "\\bshort\\b" << "\\bsignals\\b" << "\\bsigned\\b"
-                    << "\\bsizeof\\b" << "\\bslots\\b" << "\\bstatic\\b"
-                    << "\\bstatic_assert\\b" << "\\bstatic_cast\\b" << "\\bstruct\\b"
-                    << "\\bswitch\\b" << "\\btemplate\\b" << "\\bthis\\b"
-                    << "\\bthread_local\\b" << "\\bthrow\\b" << "\\btrue\\b"
-                    << "\\btry\\b" << "\\btypedef\\b" << "\\btypeid\\b"
-                    << "\\btypename\\b" << "\\bunion\\b" << "\\bunsigned\\b"
-                    << "\\busing\\b" << "\\bvirtual\\b" << "\\bvoid\\b"
-                    << "\\bvolatile\\b" << "\\bwchar_t\\b" << "\\bwhile\\b"
-                    << "\\b__attribute__\\b" << "\\b__thread\\b" << "\\b__typeof__\\b";
-
-    for (QString const& pattern: keywordPatterns) {
-      rule.pattern = QRegExp(pattern);
-      rule.format = keywordFormat;
-      highlightingRules.append(rule);
-    }
-
-    digitsFormat.setForeground(Qt::darkBlue);
-    rule.pattern = QRegExp("\\d+");
-    rule.format = digitsFormat;
-    highlightingRules.append(rule);
-
-    classFormat.setForeground(Qt::darkMagenta);
-    rule.pattern = QRegExp("\\bQ[A-Za-z]+\\b");
-    rule.format = classFormat;
-    highlightingRules.append(rule);
-
-    defineFormat.setForeground(Qt::darkBlue);
-    rule.pattern = QRegExp("^#\\s*define\\s+[A-Z_]+");
-    rule.format = defineFormat;
-    highlightingRules.append(rule);
-
-    includeFormat.setForeground(Qt::darkGreen);
-    rule.pattern = QRegExp("^#\\s*include\\s+.+");
-    rule.format = includeFormat;
-    highlightingRules.append(rule);
-
-    macroFormat.setForeground(Qt::darkBlue);
-    rule.pattern = QRegExp("^#\\s*\\w+");
-    rule.format = macroFormat;
-    highlightingRules.append(rule);
-
-    qAndDPointersFormat.setForeground(Qt::darkRed);
-    rule.pattern = QRegExp("\\bq\\b | \\bd\\b");
-    rule.format = qAndDPointersFormat;
-    highlightingRules.append(rule);
-
-    semicolonFormat.setForeground(QColor("#444"));
-    rule.pattern = QRegExp(":+");
-    rule.format = semicolonFormat;
-    highlightingRules.append(rule);
-
-    quotationFormat.setForeground(Qt::darkGreen);
-    rule.pattern = QRegExp("\".*\"");
-    rule.format = quotationFormat;
-    highlightingRules.append(rule);
-
-    singleLineCommentFormat.setForeground(Qt::darkGreen);
-    rule.pattern = QRegExp("//[^\n]*");
-    rule.format = singleLineCommentFormat;
-    highlightingRules.append(rule);
-
-    multiLineCommentFormat.setForeground(Qt::darkGreen);
-
-    commentStartExpression = QRegExp("/\\*");
-    commentEndExpression = QRegExp("\\*/");
+#include <QScrollBar>
+#include <QTextLayout>
+#include <QElapsedTimer>
+
+#include "CodeEditor.hxx"
+
+namespace {
+  int const g_visibleMarginBlockCount = 50;
+  /// User state of the blocks laid out already, kept with documents set back in the editor
+  int const g_highlightedBlockState = 1;
+  /// Well within a 60 fps frame
+  qint64 const g_idleSliceDurationMs = 6;
 }
 
-void Highlighter::highlightBlock(const QString& p_text)
-{
-  for (HighlightingRule const& rule: highlightingRules) {
-    QRegExp expression(rule.pattern);
-    int index = expression.indexIn(p_text);
-    while (index >= 0) {
-      int length = expression.matchedLength();
-      setFormat(index, length, rule.format);
-      index = expression.indexIn(p_text, index + length);
-    }
+Highlighter::Highlighter(CodeEditor* p_editor):
+  QObject(p_editor),
+  m_editor(p_editor),
+  m_idleTimer(),
+  m_tokens(),
+  m_nextIdleBlockNumber(0) {
+
+  m_formats[CppLexer::eKeywordToken].setForeground(Qt::darkYellow);
+  m_formats[CppLexer::eQtClassToken].setForeground(Qt::darkMagenta);
+  m_formats[CppLexer::eQtMacroToken].setForeground(Qt::darkBlue);
+  m_formats[CppLexer::eSignalSlotMacroToken].setForeground(Qt::darkMagenta);
+  m_formats[CppLexer::eQAndDPointerToken].setForeground(Qt::darkRed);
+  m_formats[CppLexer::eScopeToken].setForeground(QColor("#444"));
+  m_formats[CppLexer::eLabelToken].setForeground(Qt::darkRed);
+  m_formats[CppLexer::eColonToken].setForeground(QColor("#444"));
+  m_formats[CppLexer::eNumberToken].setForeground(Qt::darkBlue);
+  m_formats[CppLexer::eStringToken].setForeground(Qt::darkGreen);
+  m_formats[CppLexer::eCommentToken].setForeground(Qt::darkGreen);
+  m_formats[CppLexer::eDirectiveToken].setForeground(Qt::darkBlue);
+  m_formats[CppLexer::eDefineToken].setForeground(Qt::darkBlue);
+  m_formats[CppLexer::eIncludeToken].setForeground(Qt::darkGreen);
+
+  connect(m_editor, SIGNAL(documentTokensReady(DocumentTokens)), this, SLOT(setDocumentTokens(DocumentTokens)));
+
+  m_idleTimer.setInterval(0);
+  connect(&m_idleTimer, SIGNAL(timeout()), this, SLOT(highlightNextChunk()));
+  connect(m_editor->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(highlightVisibleBlocks()));
+}
+
+/// Private slots
+
+void Highlighter::setDocumentTokens(DocumentTokens const& p_tokens) {
+  m_tokens = p_tokens;
+  m_nextIdleBlockNumber = 0;
+  if (!isCurrent()) {
+    m_idleTimer.stop();
+    return;
+  }
+
+  highlightVisibleBlocks();
+  m_idleTimer.start();
+}
+
+void Highlighter::highlightVisibleBlocks() {
+  if (!isCurrent()) {
+    return;
+  }
+
+  int firstBlockNumber = m_editor->cursorForPosition(QPoint(0, 0)).blockNumber();
+  int lastBlockNumber = m_editor->cursorForPosition(QPoint(0, m_editor->viewport()->height())).blockNumber();
+  firstBlockNumber = qMax(0, firstBlockNumber-g_visibleMarginBlockCount);
+  lastBlockNumber = qMin(m_tokens.lineCount()-1, lastBlockNumber+g_visibleMarginBlockCount);
+
+  QTextBlock block = m_editor->document()->findBlockByNumber(firstBlockNumber);
+  for (int blockNumber = firstBlockNumber; blockNumber <= lastBlockNumber && block.isValid(); ++blockNumber) {
+    highlightBlock(block);
+    block = block.next();
+  }
+}
+
+void Highlighter::highlightNextChunk() {
+  if (!isCurrent()) {
+    m_idleTimer.stop();
+    return;
   }
-  setCurrentBlockState(0);
 
-  int startIndex = 0;
-  if (previousBlockState() != 1) {
-    startIndex = commentStartExpression.indexIn(p_text);
+  QElapsedTimer sliceTimer;
+  sliceTimer.start();
+  QTextBlock block = m_editor->document()->findBlockByNumber(m_nextIdleBlockNumber);
+  while (block.isValid() && m_nextIdleBlockNumber < m_tokens.lineCount() && sliceTimer.elapsed() < g_idleSliceDurationMs) {
+    highlightBlock(block);
+    block = block.next();
+    ++m_nextIdleBlockNumber;
   }
 
-  while (startIndex >= 0) {
-    int endIndex = commentEndExpression.indexIn(p_text, startIndex);
-    int commentLength;
-    if (endIndex == -1) {
-      setCurrentBlockState(1);
-      commentLength = p_text.length() - startIndex;
-    } else {
-      commentLength = endIndex - startIndex + commentEndExpression.matchedLength();
-    }
-    setFormat(startIndex, commentLength, multiLineCommentFormat);
-    startIndex = commentStartExpression.indexIn(p_text, startIndex + commentLength);
+  if (!block.isValid() || m_nextIdleBlockNumber == m_tokens.lineCount()) {
+    m_idleTimer.stop();
   }
 }
+
+
+/// Private
+
+void Highlighter::highlightBlock(QTextBlock const& p_block) {
+  int blockNumber = p_block.blockNumber();
+  if (blockNumber >= m_tokens.lineCount() || p_block.userState() == g_highlightedBlockState) {
+    return;
+  }
+
+  int firstToken = m_tokens.lineFirstToken(blockNumber);
+  int lastToken = m_tokens.lineTokenEnd(blockNumber);
+  QList<QTextLayout::FormatRange> formatRanges;
+  formatRanges.reserve(lastToken-firstToken);
+  for (int k = firstToken; k < lastToken; ++k) {
+    CppLexer::Token const& token = m_tokens.token(k);
+    QTextLayout::FormatRange formatRange;
+    formatRange.start = token.start;
+    formatRange.length = token.length;
+    formatRange.format = m_formats[token.kind];
+    formatRanges << formatRange;
+  }
+  p_block.layout()->setAdditionalFormats(formatRanges);
+  m_editor->document()->markContentsDirty(p_block.position(), p_block.length());
+  QTextBlock(p_block).setUserState(g_highlightedBlockState);
+}
+
+bool Highlighter::isCurrent() const {
+  // The editor content may have been replaced before its tokens were sent
+  return !m_tokens.isEmpty() && m_tokens.lineCount() == m_editor->document()->blockCount();
+}
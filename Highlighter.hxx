@@ -41,45 +41,42 @@
 #ifndef HIGHLIGHTER_H
 #define HIGHLIGHTER_H
 
-#include <QSyntaxHighlighter>
+#include <QObject>
+#include <QTextBlock>
 #include <QTextCharFormat>
+#include <QTimer>
 
-class QTextDocument;
+#include "CppLexer.hxx"
+#include "DocumentTokens.hxx"
 
-class Highlighter: public QSyntaxHighlighter {
+class CodeEditor;
+
+/// Colors the blocks of a read-only editor with the tokens its content was
+/// lexed into, laid out as additional formats: the blocks around the viewport
+/// as soon as the tokens arrive and as the editor is scrolled, the others by
+/// time slices short enough to keep the event loop responsive.
+class Highlighter: public QObject {
   Q_OBJECT
 
 public:
-  Highlighter(QTextDocument* parent = nullptr);
+  explicit Highlighter(CodeEditor* p_editor);
 
-protected:
-  void highlightBlock(const QString& p_text) override;
+private slots:
+  /// Starts over with the tokens of the content just set in the editor
+  void setDocumentTokens(DocumentTokens const& p_tokens);
+  void highlightVisibleBlocks();
+  void highlightNextChunk();
 
 private:
-  struct HighlightingRule {
-    QRegExp pattern;
-    QTextCharFormat format;
-  };
-  QVector<HighlightingRule> highlightingRules;
+  void highlightBlock(QTextBlock const& p_block);
+  bool isCurrent() const;
 
-  QRegExp commentStartExpression;
-  QRegExp commentEndExpression;
+  CodeEditor* m_editor;
+  QTextCharFormat m_formats[CppLexer::eTokenKindsCount];
+  QTimer m_idleTimer;
 
-  QTextCharFormat keywordFormat;
-  QTextCharFormat classFormat;
-  QTextCharFormat singleLineCommentFormat;
-  QTextCharFormat multiLineCommentFormat;
-  QTextCharFormat quotationFormat;
-  QTextCharFormat defineFormat;
-  QTextCharFormat includeFormat;
-  QTextCharFormat macroFormat;
-  QTextCharFormat qmacroFormat;
-  QTextCharFormat digitsFormat;
-  QTextCharFormat signalSlotMacroFormat;
-  QTextCharFormat labelFormat;
-  QTextCharFormat noLabelFormat;
-  QTextCharFormat semicolonFormat;
-  QTextCharFormat qAndDPointersFormat;
+  DocumentTokens m_tokens;
+  int m_nextIdleBlockNumber;
 };
 
 #endif // HIGHLIGHTER_H
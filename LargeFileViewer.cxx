@@ -0,0 +1,209 @@
+#include "LargeFileViewer.hxx"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+#include <QScrollBar>
+
+#include <cstring>
+#include <climits>
+
+namespace {
+  qint64 const g_sizeThreshold = 8*1024*1024;
+  /// Guess of the average line length, to reserve the line index at once
+  qint64 const g_expectedLineLength = 40;
+  int const g_tabWidth = 8;
+}
+
+LargeFileViewer::LargeFileViewer(QWidget* p_parent):
+  QAbstractScrollArea(p_parent),
+  m_file(),
+  m_data(nullptr),
+  m_size(0),
+  m_content(),
+  m_lineStarts(),
+  m_longestLineLength(0),
+  m_currentLine(0) {
+
+  setFocusPolicy(Qt::StrongFocus);
+  viewport()->setCursor(Qt::IBeamCursor);
+}
+
+LargeFileViewer::~LargeFileViewer() {
+  closeFile();
+}
+
+/// Public
+
+qint64 LargeFileViewer::sizeThreshold() {
+  return g_sizeThreshold;
+}
+
+bool LargeFileViewer::openFile(QString const& p_absoluteFilePath) {
+  closeFile();
+
+  m_file.setFileName(p_absoluteFilePath);
+  if (!m_file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  m_size = m_file.size();
+  m_data = reinterpret_cast<char const*>(m_file.map(0, m_size));
+  if (m_data == nullptr) {
+    m_content = m_file.readAll();
+    m_data = m_content.constData();
+    m_size = m_content.size();
+  }
+
+  // Lines end with a line feed, a carriage return before it is left out when painting
+  m_lineStarts.reserve(int(m_size/g_expectedLineLength)+1);
+  m_lineStarts << 0;
+  char const* lineStart = m_data;
+  char const* end = m_data+m_size;
+  while (char const* lineEnd = static_cast<char const*>(std::memchr(lineStart, '\n', end-lineStart))) {
+    m_longestLineLength = int(qMax(qint64(m_longestLineLength), qint64(lineEnd-lineStart)));
+    lineStart = lineEnd+1;
+    m_lineStarts << lineStart-m_data;
+  }
+  m_longestLineLength = int(qMax(qint64(m_longestLineLength), qint64(end-lineStart)));
+  m_lineStarts.squeeze();
+
+  m_currentLine = 0;
+  updateScrollBars();
+  verticalScrollBar()->setValue(0);
+  horizontalScrollBar()->setValue(0);
+  viewport()->update();
+  return true;
+}
+
+void LargeFileViewer::closeFile() {
+  if (m_file.isOpen()) {
+    m_file.close();
+  }
+  m_data = nullptr;
+  m_size = 0;
+  m_content.clear();
+  m_lineStarts.clear();
+  m_longestLineLength = 0;
+  m_currentLine = 0;
+  updateScrollBars();
+  viewport()->update();
+}
+
+void LargeFileViewer::goToLineNumber(int p_lineNumber) {
+  if (m_lineStarts.isEmpty()) {
+    return;
+  }
+
+  m_currentLine = qBound(0, p_lineNumber-1, m_lineStarts.size()-1);
+  verticalScrollBar()->setValue(m_currentLine-visibleLineCount()/2);
+  viewport()->update();
+}
+
+
+/// Protected
+
+void LargeFileViewer::paintEvent(QPaintEvent* p_event) {
+  QPainter painter(viewport());
+  painter.fillRect(p_event->rect(), palette().base());
+
+  int lineHeight = fontMetrics().height();
+  int characterWidth = fontMetrics().width(QLatin1Char('9'));
+  int numberAreaWidth = lineNumberAreaWidth();
+  int textLeft = numberAreaWidth+4;
+  int textWidth = viewport()->width()-textLeft;
+  painter.fillRect(0, 0, numberAreaWidth, viewport()->height(), QColor("#EFEFEF"));
+
+  // Only the columns from the left of the viewport to its right are decoded and laid out
+  int horizontalOffset = horizontalScrollBar()->value();
+  int firstColumn = horizontalOffset/characterWidth;
+  int columnCount = textWidth/characterWidth+2;
+  int textX = textLeft-(horizontalOffset-firstColumn*characterWidth);
+
+  int firstLine = verticalScrollBar()->value();
+  int lastLine = qMin(m_lineStarts.size()-1, firstLine+viewport()->height()/lineHeight+1);
+  for (int line = firstLine; line <= lastLine; ++line) {
+    int top = (line-firstLine)*lineHeight;
+    if (line == m_currentLine) {
+      painter.fillRect(numberAreaWidth, top, viewport()->width()-numberAreaWidth, lineHeight, QColor("#E0EEF6"));
+    }
+
+    painter.setPen(Qt::black);
+    painter.setClipping(false);
+    painter.drawText(0, top, numberAreaWidth, lineHeight, Qt::AlignRight, QString::number(line+1));
+
+    painter.setPen(palette().text().color());
+    painter.setClipRect(textLeft, top, textWidth, lineHeight);
+    painter.drawText(textX, top+fontMetrics().ascent(), lineText(line, firstColumn+columnCount).mid(firstColumn));
+  }
+}
+
+void LargeFileViewer::resizeEvent(QResizeEvent* p_event) {
+  QAbstractScrollArea::resizeEvent(p_event);
+  updateScrollBars();
+}
+
+void LargeFileViewer::mousePressEvent(QMouseEvent* p_event) {
+  int line = verticalScrollBar()->value()+p_event->pos().y()/fontMetrics().height();
+  if (line < m_lineStarts.size()) {
+    m_currentLine = line;
+    viewport()->update();
+  }
+  QAbstractScrollArea::mousePressEvent(p_event);
+}
+
+
+/// Private
+
+QString LargeFileViewer::lineText(int p_line, int p_maximumLength) const {
+  qint64 lineStart = m_lineStarts.at(p_line);
+  qint64 lineEnd = p_line+1 < m_lineStarts.size() ? m_lineStarts.at(p_line+1)-1 : m_size;
+  if (lineEnd > lineStart && m_data[lineEnd-1] == '\r') {
+    --lineEnd;
+  }
+
+  // Up to four bytes per character in UTF-8
+  qint64 byteCount = qMin(lineEnd-lineStart, qint64(p_maximumLength)*4);
+  QString text = QString::fromUtf8(m_data+lineStart, int(byteCount));
+
+  QString expandedText;
+  expandedText.reserve(qMin(text.size(), p_maximumLength));
+  for (QChar character: text) {
+    if (expandedText.size() >= p_maximumLength) {
+      break;
+    }
+    if (character == QLatin1Char('\t')) {
+      expandedText.append(QString(g_tabWidth-expandedText.size()%g_tabWidth, QLatin1Char(' ')));
+    } else {
+      expandedText.append(character);
+    }
+  }
+  return expandedText;
+}
+
+int LargeFileViewer::lineNumberAreaWidth() const {
+  int digits = 1;
+  int max = qMax(1, m_lineStarts.size());
+  while (max >= 10) {
+    max /= 10;
+    ++digits;
+  }
+
+  return 3+fontMetrics().width(QLatin1Char('9'))*digits;
+}
+
+int LargeFileViewer::visibleLineCount() const {
+  return qMax(1, viewport()->height()/fontMetrics().height());
+}
+
+void LargeFileViewer::updateScrollBars() {
+  int visibleLines = visibleLineCount();
+  verticalScrollBar()->setRange(0, qMax(0, m_lineStarts.size()-visibleLines));
+  verticalScrollBar()->setPageStep(visibleLines);
+  verticalScrollBar()->setSingleStep(1);
+
+  int characterWidth = fontMetrics().width(QLatin1Char('9'));
+  qint64 contentWidth = qint64(m_longestLineLength)*characterWidth+lineNumberAreaWidth()+4;
+  horizontalScrollBar()->setRange(0, int(qMin(qint64(INT_MAX/2), qMax(qint64(0), contentWidth-viewport()->width()))));
+  horizontalScrollBar()->setPageStep(viewport()->width());
+  horizontalScrollBar()->setSingleStep(characterWidth);
+}
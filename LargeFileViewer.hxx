@@ -0,0 +1,51 @@
+#ifndef LARGEFILEVIEWER_HXX
+#define LARGEFILEVIEWER_HXX
+
+#include <QAbstractScrollArea>
+#include <QFile>
+#include <QByteArray>
+#include <QVector>
+
+/// Read-only view of a file too large to be laid out by a QPlainTextEdit.
+/// The file is memory mapped, its line starts are indexed once, and only the
+/// lines in the viewport are decoded and painted, so that the cost of
+/// opening it and the memory it takes barely depend on its size.
+class LargeFileViewer: public QAbstractScrollArea {
+  Q_OBJECT
+
+public:
+  explicit LargeFileViewer(QWidget* p_parent = nullptr);
+  ~LargeFileViewer();
+
+  /// Files above this size are opened in this viewer rather than in the code editor
+  static qint64 sizeThreshold();
+
+  bool openFile(QString const& p_absoluteFilePath);
+  void closeFile();
+
+  int lineCount() const { return m_lineStarts.size(); }
+  void goToLineNumber(int p_lineNumber);
+
+protected:
+  void paintEvent(QPaintEvent* p_event) override;
+  void resizeEvent(QResizeEvent* p_event) override;
+  void mousePressEvent(QMouseEvent* p_event) override;
+
+private:
+  QString lineText(int p_line, int p_maximumLength) const;
+  int lineNumberAreaWidth() const;
+  int visibleLineCount() const;
+  void updateScrollBars();
+
+  QFile m_file;
+  /// Mapped file, or content read when it cannot be mapped
+  char const* m_data;
+  qint64 m_size;
+  QByteArray m_content;
+
+  QVector<qint64> m_lineStarts;
+  int m_longestLineLength;
+  int m_currentLine;
+};
+
+#endif // LARGEFILEVIEWER_HXX
@@ -0,0 +1,39 @@
+#include "LineIndex.hxx"
+
+#include <algorithm>
+
+namespace {
+  /// Guess of the average line length, to reserve the index at once
+  int const g_expectedLineLength = 32;
+}
+
+LineIndex::LineIndex():
+  m_lineStarts() {
+
+  m_lineStarts << 0;
+}
+
+/// Public
+
+void LineIndex::build(QString const& p_text) {
+  clear();
+  m_lineStarts.reserve(p_text.size()/g_expectedLineLength+1);
+
+  // QString::indexOf scans for a single character with SIMD instructions
+  int lineEnd = p_text.indexOf(QLatin1Char('\n'));
+  while (lineEnd >= 0) {
+    m_lineStarts << lineEnd+1;
+    lineEnd = p_text.indexOf(QLatin1Char('\n'), lineEnd+1);
+  }
+  m_lineStarts.squeeze();
+}
+
+void LineIndex::clear() {
+  m_lineStarts.clear();
+  m_lineStarts << 0;
+}
+
+int LineIndex::lineAt(int p_offset) const {
+  auto line = std::upper_bound(m_lineStarts.cbegin(), m_lineStarts.cend(), p_offset);
+  return qMax(0, int(line-m_lineStarts.cbegin())-1);
+}
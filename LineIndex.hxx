@@ -0,0 +1,27 @@
+#ifndef LINEINDEX_HXX
+#define LINEINDEX_HXX
+
+#include <QString>
+#include <QVector>
+
+/// Start offsets of the lines of a text, to go from an offset to its line
+/// and back without walking the blocks of a document.
+class LineIndex {
+public:
+  LineIndex();
+
+  /// Indexes the lines of a text ending with line feeds
+  void build(QString const& p_text);
+  void clear();
+
+  int lineCount() const { return m_lineStarts.size(); }
+  /// Offset of a line, numbered from 0
+  int lineStart(int p_line) const { return m_lineStarts.at(p_line); }
+  /// Line holding an offset, numbered from 0
+  int lineAt(int p_offset) const;
+
+private:
+  QVector<int> m_lineStarts;
+};
+
+#endif // LINEINDEX_HXX
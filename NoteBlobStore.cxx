@@ -0,0 +1,58 @@
+#include "NoteBlobStore.hxx"
+
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QCache>
+
+namespace {
+  /// In KB, about 64 MB of decoded images
+  int const g_imageCacheMaximumCost = 64*1024;
+}
+
+/// Public
+
+QUrl NoteBlobStore::store(QByteArray const& p_data, QString const& p_format) {
+  QString blobName = QString::fromLatin1(QCryptographicHash::hash(p_data, QCryptographicHash::Sha1).toHex())+"."+p_format.toLower();
+  QString blobFilePath = blobDirectoryPath()+QDir::separator()+blobName;
+
+  // The same image pasted again, in this note or another, is already there
+  if (!QFileInfo::exists(blobFilePath)) {
+    QDir().mkpath(blobDirectoryPath());
+    QSaveFile blobFile(blobFilePath);
+    if (!blobFile.open(QIODevice::WriteOnly) || blobFile.write(p_data) != p_data.size() || !blobFile.commit()) {
+      return QUrl();
+    }
+  }
+
+  QUrl url;
+  url.setScheme(blobScheme());
+  url.setPath(blobName);
+  return url;
+}
+
+QImage NoteBlobStore::image(QUrl const& p_url) {
+  static QCache<QString, QImage> images(g_imageCacheMaximumCost);
+
+  // Blob names have no directory part
+  QString blobName = QFileInfo(p_url.path()).fileName();
+  QImage* image = images.object(blobName);
+  if (image != nullptr) {
+    return *image;
+  }
+
+  QImage decodedImage(blobDirectoryPath()+QDir::separator()+blobName);
+  if (!decodedImage.isNull()) {
+    images.insert(blobName, new QImage(decodedImage), qMax(1, decodedImage.byteCount()/1024));
+  }
+  return decodedImage;
+}
+
+
+/// Private
+
+QString NoteBlobStore::blobDirectoryPath() {
+  QFileInfo blobsPathFileInfo("../QtSourceCodeBrowser/blobs/");
+  return blobsPathFileInfo.absolutePath();
+}
@@ -0,0 +1,26 @@
+#ifndef NOTEBLOBSTORE_HXX
+#define NOTEBLOBSTORE_HXX
+
+#include <QString>
+#include <QByteArray>
+#include <QImage>
+#include <QUrl>
+
+/// Images of the notes, each one stored once in a file named after the hash
+/// of its encoded data, in a directory next to the notes. Notes refer to them
+/// by blob URLs and they are decoded only when displayed, the last decoded
+/// being shared by every note showing them.
+class NoteBlobStore {
+public:
+  /// Stores encoded image data unless stored already, returns its blob URL, invalid on failure
+  static QUrl store(QByteArray const& p_data, QString const& p_format);
+  static bool isBlobUrl(QUrl const& p_url) { return p_url.scheme() == blobScheme(); }
+  /// Decoded image of a blob URL, null if its file cannot be read
+  static QImage image(QUrl const& p_url);
+
+private:
+  static QString blobScheme() { return QStringLiteral("blob"); }
+  static QString blobDirectoryPath();
+};
+
+#endif // NOTEBLOBSTORE_HXX
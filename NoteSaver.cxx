@@ -0,0 +1,123 @@
+#include "NoteSaver.hxx"
+
+#include <QRunnable>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+
+namespace {
+  /// In milliseconds, the most work a crash may lose
+  int const g_autosaveDelay = 2000;
+}
+
+class NoteSaverWorker: public QRunnable {
+public:
+  NoteSaverWorker(NoteSaver* p_saver, QString const& p_absoluteFilePath, QString const& p_notesAbsoluteFilePath, QString const& p_html, int p_revision):
+    QRunnable(),
+    m_saver(p_saver),
+    m_absoluteFilePath(p_absoluteFilePath),
+    m_notesAbsoluteFilePath(p_notesAbsoluteFilePath),
+    m_html(p_html),
+    m_revision(p_revision) {
+
+    setAutoDelete(true);
+  }
+
+  void run() override {
+    QDir().mkpath(QFileInfo(m_notesAbsoluteFilePath).absolutePath());
+
+    // The notes file is replaced only once the whole snapshot is written
+    QSaveFile notesFile(m_notesAbsoluteFilePath);
+    bool succeeded = notesFile.open(QIODevice::WriteOnly | QIODevice::Text);
+    if (succeeded) {
+      QByteArray data = m_html.toUtf8();
+      succeeded = notesFile.write(data) == data.size() && notesFile.commit();
+    }
+    emit m_saver->notesWritten(m_absoluteFilePath, m_revision, succeeded, succeeded ? QString() : notesFile.errorString());
+  }
+
+private:
+  NoteSaver* m_saver;
+  QString m_absoluteFilePath;
+  QString m_notesAbsoluteFilePath;
+  QString m_html;
+  int m_revision;
+};
+
+
+NoteSaver::NoteSaver(QObject* p_parent):
+  QObject(p_parent),
+  m_threadPool(),
+  m_autosaveTimer(),
+  m_modifiedFilePaths(),
+  m_revisions(),
+  m_lastRevision(0) {
+
+  m_threadPool.setMaxThreadCount(1);
+  m_autosaveTimer.setSingleShot(true);
+  m_autosaveTimer.setInterval(g_autosaveDelay);
+  connect(&m_autosaveTimer, SIGNAL(timeout()), this, SLOT(emitSaveDue()));
+  connect(this, SIGNAL(notesWritten(QString,int,bool,QString)), this, SLOT(reportNotesWritten(QString,int,bool,QString)), Qt::QueuedConnection);
+}
+
+NoteSaver::~NoteSaver() {
+  // Snapshots taken are all written, none is dropped
+  m_threadPool.waitForDone();
+}
+
+/// Public
+
+void NoteSaver::markModified(QString const& p_absoluteFilePath) {
+  m_revisions.insert(p_absoluteFilePath, ++m_lastRevision);
+  if (!m_modifiedFilePaths.contains(p_absoluteFilePath)) {
+    m_modifiedFilePaths << p_absoluteFilePath;
+  }
+
+  // Not restarted on later modifications, so that continuous typing is saved too
+  if (!m_autosaveTimer.isActive()) {
+    m_autosaveTimer.start();
+  }
+}
+
+void NoteSaver::save(QString const& p_absoluteFilePath, QString const& p_notesAbsoluteFilePath, QString const& p_html) {
+  m_modifiedFilePaths.removeOne(p_absoluteFilePath);
+  if (!m_revisions.contains(p_absoluteFilePath)) {
+    m_revisions.insert(p_absoluteFilePath, ++m_lastRevision);
+  }
+
+  m_threadPool.start(new NoteSaverWorker(this, p_absoluteFilePath, p_notesAbsoluteFilePath, p_html, m_revisions.value(p_absoluteFilePath)));
+}
+
+void NoteSaver::forget(QString const& p_absoluteFilePath) {
+  m_modifiedFilePaths.removeOne(p_absoluteFilePath);
+  m_revisions.remove(p_absoluteFilePath);
+}
+
+void NoteSaver::forgetAll() {
+  m_modifiedFilePaths.clear();
+  m_revisions.clear();
+  m_autosaveTimer.stop();
+}
+
+
+/// Private slots
+
+void NoteSaver::emitSaveDue() {
+  if (m_modifiedFilePaths.isEmpty()) {
+    return;
+  }
+
+  QStringList modifiedFilePaths = m_modifiedFilePaths;
+  m_modifiedFilePaths.clear();
+  emit saveDue(modifiedFilePaths);
+}
+
+void NoteSaver::reportNotesWritten(QString const& p_absoluteFilePath, int p_revision, bool p_succeeded, QString const& p_errorString) {
+  // Notes closed since, or closed and opened again
+  auto revision = m_revisions.constFind(p_absoluteFilePath);
+  if (revision == m_revisions.constEnd() || (p_succeeded && revision.value() != p_revision)) {
+    return;
+  }
+
+  emit notesSaved(p_absoluteFilePath, p_succeeded, p_errorString);
+}
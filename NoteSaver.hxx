@@ -0,0 +1,53 @@
+#ifndef NOTESAVER_HXX
+#define NOTESAVER_HXX
+
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+#include <QStringList>
+#include <QHash>
+
+/// Writes notes on a worker thread, each one to a temporary file renamed over
+/// the previous once complete, so that a failed or interrupted write leaves the
+/// last saved notes intact. Modified notes are gathered for a short while and
+/// saveDue is emitted for all of them at once, to be snapshotted and saved.
+/// Notes are known by the absolute path of their source file.
+class NoteSaver: public QObject {
+  Q_OBJECT
+
+  friend class NoteSaverWorker;
+
+public:
+  explicit NoteSaver(QObject* p_parent = nullptr);
+  ~NoteSaver();
+
+  /// Notes modified, saveDue will be emitted for them within the autosave delay
+  void markModified(QString const& p_absoluteFilePath);
+  /// Writes a snapshot of notes in the background, notesSaved is emitted once done
+  void save(QString const& p_absoluteFilePath, QString const& p_notesAbsoluteFilePath, QString const& p_html);
+  /// Notes closed, writes under way are completed but no longer reported
+  void forget(QString const& p_absoluteFilePath);
+  void forgetAll();
+
+signals:
+  /// Notes to be snapshotted and saved
+  void saveDue(QStringList p_absoluteFilePaths);
+  /// Emitted on success only if the notes were not modified after their snapshot
+  void notesSaved(QString p_absoluteFilePath, bool p_succeeded, QString p_errorString);
+  void notesWritten(QString p_absoluteFilePath, int p_revision, bool p_succeeded, QString p_errorString);
+
+private slots:
+  void emitSaveDue();
+  void reportNotesWritten(QString const& p_absoluteFilePath, int p_revision, bool p_succeeded, QString const& p_errorString);
+
+private:
+  /// Writes are done one at a time, in the order of the snapshots
+  QThreadPool m_threadPool;
+  QTimer m_autosaveTimer;
+  QStringList m_modifiedFilePaths;
+  /// Revision of the notes of each source, increased on each modification
+  QHash<QString, int> m_revisions;
+  int m_lastRevision;
+};
+
+#endif // NOTESAVER_HXX
@@ -8,7 +8,7 @@
 #include <QMouseEvent>
 #include <QDebug>
 
-#include <stdlib.h>
+#include "NoteBlobStore.hxx"
 
 
 NoteTextEdit::NoteTextEdit(QWidget* p_parent):
@@ -73,24 +73,34 @@ void NoteTextEdit::dropImage(QImage const& p_image, QString const& p_format) {
   p_image.save(&buffer, p_format.toLocal8Bit().data());
   buffer.close();
 
-  QByteArray base64 = bytes.toBase64();
-  QByteArray base64l;
-
-  for (int i = 0; i < base64.size(); ++i) {
-    base64l.append(base64[i]);
-    if (i%80 == 0) {
-      base64l.append("\n");
-    }
+  // The note refers to the stored image, the image shown is the one just pasted. An image that
+  // cannot be stored is inlined in the note as before, rather than lost
+  QString imageName;
+  QUrl url = NoteBlobStore::store(bytes, p_format);
+  if (url.isValid()) {
+    document()->addResource(QTextDocument::ImageResource, url, p_image);
+    imageName = url.toString();
+  } else {
+    imageName = QString("data:image/%1;base64,%2").arg(p_format.toLower(), QString::fromLatin1(bytes.toBase64()));
   }
 
   QTextCursor cursor = textCursor();
   QTextImageFormat imageFormat;
   imageFormat.setWidth(p_image.width());
   imageFormat.setHeight(p_image.height());
-  imageFormat.setName(QString("data:image/%1;base64,%2").arg(QString("%1.%2").arg(rand()).arg(p_format)).arg(base64l.data()));
+  imageFormat.setName(imageName);
   cursor.insertImage(imageFormat);
 }
 
+QVariant NoteTextEdit::loadResource(int p_type, QUrl const& p_name) {
+  // Stored images are decoded once laid out, the document keeps them then
+  if (p_type == QTextDocument::ImageResource && NoteBlobStore::isBlobUrl(p_name)) {
+    return NoteBlobStore::image(p_name);
+  }
+
+  return QTextBrowser::loadResource(p_type, p_name);
+}
+
 void NoteTextEdit::mouseMoveEvent(QMouseEvent* p_event) {
   if (!isReadOnly()) {
     QTextBrowser::mouseMoveEvent(p_event);
@@ -23,6 +23,7 @@ protected:
   void mousePressEvent(QMouseEvent* p_event) override;
   void keyReleaseEvent(QKeyEvent* p_event) override;
   void mouseDoubleClickEvent(QMouseEvent* p_event) override;
+  QVariant loadResource(int p_type, QUrl const& p_name) override;
 
 protected slots:
   void hasModificationsNotSaved();
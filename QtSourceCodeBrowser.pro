@@ -10,7 +10,32 @@ SOURCES += \
     NoteTextEdit.cxx \
     NoteRichTextEdit.cxx \
     SourceCodeEditor.cxx \
-    SourcesAndOpenFiles.cxx
+    SourcesAndOpenFiles.cxx \
+    SourceIndexer.cxx \
+    SourceIndex.cxx \
+    SourceIndexSnapshot.cxx \
+    SourceIndexWatcher.cxx \
+    SourceSearchModel.cxx \
+    FuzzyFileFinder.cxx \
+    SourceSearchItemDelegate.cxx \
+    SourceSearcher.cxx \
+    SourceTreeFilter.cxx \
+    FileTypes.cxx \
+    GrepEngine.cxx \
+    GrepResultsModel.cxx \
+    ContentIndex.cxx \
+    ContentIndexBuilder.cxx \
+    SymbolIndex.cxx \
+    SymbolIndexer.cxx \
+    CppLexer.cxx \
+    DocumentTokens.cxx \
+    LargeFileViewer.cxx \
+    FileLoader.cxx \
+    DocumentCache.cxx \
+    FindEngine.cxx \
+    LineIndex.cxx \
+    NoteSaver.cxx \
+    NoteBlobStore.cxx
 
 HEADERS += \
     MainWindow.hxx \
@@ -23,7 +48,36 @@ HEADERS += \
     NoteTextEdit.hxx \
     NoteRichTextEdit.hxx \
     SourceCodeEditor.hxx \
-    SourcesAndOpenFiles.hxx
+    SourcesAndOpenFiles.hxx \
+    SourceIndexer.hxx \
+    SourceIndex.hxx \
+    SourceIndexSnapshot.hxx \
+    SourceIndexWatcher.hxx \
+    SourceSearchModel.hxx \
+    FuzzyFileFinder.hxx \
+    SourceSearchItemDelegate.hxx \
+    SourceSearcher.hxx \
+    SourceTreeFilter.hxx \
+    FileTypes.hxx \
+    GrepEngine.hxx \
+    GrepResultsModel.hxx \
+    ContentIndex.hxx \
+    ContentIndexBuilder.hxx \
+    SymbolIndex.hxx \
+    SymbolIndexer.hxx \
+    CppLexer.hxx \
+    CppDeclarationParser.hxx \
+    DocumentTokens.hxx \
+    LargeFileViewer.hxx \
+    FileLoader.hxx \
+    DocumentCache.hxx \
+    FindEngine.hxx \
+    LineIndex.hxx \
+    NoteSaver.hxx \
+    NoteBlobStore.hxx
+
+RESOURCES += \
+    icons.qrc
 
 FORMS += \
     NoteRichTextEdit.ui \
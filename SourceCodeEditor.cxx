@@ -1,10 +1,16 @@
 #include "SourceCodeEditor.hxx"
 
+#include <QTextBlock>
 #include <QDebug>
 
+#include <algorithm>
+
 SourceCodeEditor::SourceCodeEditor(QWidget* p_parent):
   QWidget(p_parent),
-  m_highlighters() {
+  m_highlighters(),
+  m_largeFileViewer(),
+  m_findEngine(),
+  m_currentMatch(-1) {
 
   setupUi(this);
 
@@ -17,22 +23,31 @@ SourceCodeEditor::SourceCodeEditor(QWidget* p_parent):
   m_codeEditor->setFont(font);
   m_codeEditor->setReadOnly(true);
   m_codeEditor->setTextInteractionFlags(m_codeEditor->textInteractionFlags() | Qt::TextSelectableByKeyboard);
-  m_highlighters = new Highlighter(m_codeEditor->document());
+  m_highlighters = new Highlighter(m_codeEditor);
   connect(m_codeEditor, SIGNAL(methodListReady(QMap<int,QString>)), this, SLOT(fillMethodsComboBox(QMap<int,QString>)));
 
+  // Large File Viewer, in place of the code editor for files above its size threshold
+  m_largeFileViewer = new LargeFileViewer(this);
+  m_largeFileViewer->setFont(font);
+  m_largeFileViewer->hide();
+  verticalLayout->insertWidget(verticalLayout->indexOf(m_codeEditor)+1, m_largeFileViewer);
+
   // Search Widget
   m_searchWidget->hide();
   m_nextToolButton->setText(">");
   connect(m_nextToolButton, SIGNAL(clicked()), this, SLOT(moveCursorToNextMatch()));
   connect(m_findLineEdit, SIGNAL(returnPressed()), this, SLOT(moveCursorToNextMatch()));
   m_previousToolButton->setText("<");
-  connect(m_nextToolButton, SIGNAL(clicked()), this, SLOT(moveCursorToPreviousMatch()));
+  connect(m_previousToolButton, SIGNAL(clicked()), this, SLOT(moveCursorToPreviousMatch()));
   m_regExpToolButton->setText("[]");
   m_caseSensitiveToolButton->setText("Aa");
   m_wholeWordToolButton->setText("\\b");
   m_closeToolButton->setText("X");
   connect(m_closeToolButton, SIGNAL(clicked()), m_searchWidget, SLOT(hide()));
   connect(m_findLineEdit, SIGNAL(textChanged(QString)), this, SLOT(overlineMatch(QString)));
+  connect(m_regExpToolButton, SIGNAL(toggled(bool)), this, SLOT(updateMatches()));
+  connect(m_caseSensitiveToolButton, SIGNAL(toggled(bool)), this, SLOT(updateMatches()));
+  connect(m_wholeWordToolButton, SIGNAL(toggled(bool)), this, SLOT(updateMatches()));
 
   // Methods Combo Box
   connect(m_methodsComboBox, SIGNAL(activated(int)), this, SLOT(goToLine(int)));
@@ -51,20 +66,7 @@ void SourceCodeEditor::fillMethodsComboBox(QMap<int, QString> const& p_methodsAn
 }
 
 void SourceCodeEditor::goToLine(int p_index) {
-  QTextCursor cursor = m_codeEditor->textCursor();
-  m_codeEditor->moveCursor(QTextCursor::End);
-
-  int middleLine = m_codeEditor->viewport()->height() / (2 * m_codeEditor->fontMetrics().height());
-
-  cursor.setPosition(m_methodsComboBox->itemData(p_index).toInt());
-  m_codeEditor->setTextCursor(cursor);
-
-  for (int k = 0; k < middleLine; ++k) {
-    m_codeEditor->moveCursor(QTextCursor::Up);
-  }
-  for (int k = 0; k < middleLine; ++k) {
-    m_codeEditor->moveCursor(QTextCursor::Down);
-  }
+  m_codeEditor->goToPosition(m_methodsComboBox->itemData(p_index).toInt());
 }
 
 void SourceCodeEditor::overlineMatch(const QString& p_match) {
@@ -73,71 +75,91 @@ void SourceCodeEditor::overlineMatch(const QString& p_match) {
     caseSensitivity = Qt::CaseSensitive;
   }
 
-  QString match = p_match;
-  if (m_wholeWordToolButton->isChecked()) {
-    match = "\\b"+match+"\\b";
-  }
-
-  QRegExp regExp(match, caseSensitivity);
-  QList<QTextEdit::ExtraSelection> extraSelections;
-  m_codeEditor->moveCursor(QTextCursor::Start);
-  QColor markColor = QColor(Qt::yellow).lighter(150);
-
-  m_matchPositions.clear();
-  m_currentMatchPosition = -1;
+  // Offsets of the content are those of the document
+  m_findEngine.find(p_match, m_regExpToolButton->isChecked(), caseSensitivity, m_wholeWordToolButton->isChecked());
+  QVector<int> const& matchStarts = m_findEngine.matchStarts();
+  m_codeEditor->setMatches(matchStarts, m_findEngine.matchLengths());
 
-  int previousCursorPosition = m_codeEditor->textCursor().position();
-
-  while (m_codeEditor->find(regExp)) {
-    QTextCursor cursor = m_codeEditor->textCursor();
+  // The match at or after the current one, so that typing on keeps it selected
+  m_currentMatch = -1;
+  if (matchStarts.isEmpty()) {
+    return;
+  }
+  int currentPosition = m_codeEditor->textCursor().selectionStart();
+  int nextMatch = int(std::lower_bound(matchStarts.cbegin(), matchStarts.cend(), currentPosition)-matchStarts.cbegin());
+  m_currentMatch = nextMatch-1;
+  moveCursorToNextMatch();
+}
 
-    QTextEdit::ExtraSelection selection;
-    selection.format.setBackground(markColor);
-    selection.cursor = m_codeEditor->textCursor();
-    extraSelections.append(selection);
+void SourceCodeEditor::updateMatches() {
+  overlineMatch(m_findLineEdit->text());
+}
 
-    m_matchPositions << cursor.position();
+void SourceCodeEditor::moveCursorToNextMatch() {
+  if (m_findEngine.matchCount() == 0) {
+    return;
   }
 
-  m_codeEditor->setExtraSelections(extraSelections);
+  m_currentMatch = (m_currentMatch+1)%m_findEngine.matchCount();
+  selectMatch(m_currentMatch);
+}
 
-  for (int currentPosition: m_matchPositions) {
-    if (previousCursorPosition < currentPosition) {
-      m_currentMatchPosition = qMax(0, currentPosition-1);
-      moveCursorToNextMatch();
-    }
+void SourceCodeEditor::moveCursorToPreviousMatch() {
+  if (m_findEngine.matchCount() == 0) {
+    return;
   }
-}
 
-void SourceCodeEditor::moveCursorToNextMatch() {
-  m_currentMatchPosition = (m_currentMatchPosition+1)%m_matchPositions.size();
+  m_currentMatch = (m_currentMatch+m_findEngine.matchCount()-1)%m_findEngine.matchCount();
+  selectMatch(m_currentMatch);
+}
 
-  int currentPosition = m_matchPositions.at(m_currentMatchPosition);
-  QTextCursor cursor = m_codeEditor->textCursor();
-  cursor.setPosition(currentPosition);
-  cursor.movePosition(QTextCursor::PreviousCharacter, QTextCursor::KeepAnchor, m_findLineEdit->text().length());
-  m_codeEditor->setTextCursor(cursor);
+void SourceCodeEditor::openSourceCode(QString const& p_content, FileTypes::FileType p_fileType, QString const& p_absoluteFilePath) {
+  showLargeFileViewer(false);
+  m_codeEditor->openSourceCode(p_content, p_fileType, p_absoluteFilePath);
+  resetMatches();
 }
 
-void SourceCodeEditor::moveCursorToPreviousMatch() {
-  m_currentMatchPosition = (m_currentMatchPosition-1)%m_matchPositions.size();
+bool SourceCodeEditor::openCachedSourceCode(QString const& p_absoluteFilePath) {
+  if (!m_codeEditor->openCachedSourceCode(p_absoluteFilePath)) {
+    return false;
+  }
 
-  int currentPosition = m_matchPositions.at(m_currentMatchPosition);
-  QTextCursor cursor = m_codeEditor->textCursor();
-  cursor.setPosition(currentPosition);
-  cursor.movePosition(QTextCursor::PreviousCharacter, QTextCursor::KeepAnchor, m_findLineEdit->text().length());
-  m_codeEditor->setTextCursor(cursor);
+  showLargeFileViewer(false);
+  resetMatches();
+  return true;
 }
 
-void SourceCodeEditor::openSourceCode(QString const& p_content, CodeEditor::FileType p_fileType) {
-  m_codeEditor->openSourceCode(p_content, p_fileType);
+bool SourceCodeEditor::openLargeFile(QString const& p_absoluteFilePath) {
+  // The code editor lets its previous content go, nothing of the large file is copied in it
+  m_codeEditor->openSourceCode(QString(), FileTypes::eOtherFile);
+  resetMatches();
+  showLargeFileViewer(true);
+  return m_largeFileViewer->openFile(p_absoluteFilePath);
 }
 
 void SourceCodeEditor::setFocusToSourceEditor() {
-  m_codeEditor->setFocus();
+  if (m_largeFileViewer->isVisible()) {
+    m_largeFileViewer->setFocus();
+  } else {
+    m_codeEditor->setFocus();
+  }
+}
+
+void SourceCodeEditor::goToLineNumber(int p_lineNumber) {
+  if (m_largeFileViewer->isVisible()) {
+    m_largeFileViewer->goToLineNumber(p_lineNumber);
+    return;
+  }
+
+  m_codeEditor->goToLineNumber(p_lineNumber);
 }
 
 void SourceCodeEditor::findTextInSourceEditor() {
+  // Large files are not searched in place
+  if (m_largeFileViewer->isVisible()) {
+    return;
+  }
+
   m_searchWidget->show();
   m_findLineEdit->setFocus();
 
@@ -150,6 +172,37 @@ void SourceCodeEditor::findTextInSourceEditor() {
 }
 
 void SourceCodeEditor::clear() {
-  m_codeEditor->clear(); m_methodsComboBox->clear();
+  // Also drops the tokens and the methods of the previous content
+  m_codeEditor->openSourceCode(QString(), FileTypes::eOtherFile);
+  m_methodsComboBox->clear();
+  resetMatches();
+  showLargeFileViewer(false);
+}
+
+void SourceCodeEditor::selectMatch(int p_match) {
+  int matchStart = m_findEngine.matchStarts().at(p_match);
+  QTextCursor cursor = m_codeEditor->textCursor();
+  cursor.setPosition(matchStart);
+  cursor.setPosition(matchStart+m_findEngine.matchLengths().at(p_match), QTextCursor::KeepAnchor);
+  m_codeEditor->setTextCursor(cursor);
+}
+
+void SourceCodeEditor::resetMatches() {
+  m_findEngine.setText(m_codeEditor->content());
+  m_currentMatch = -1;
+  if (m_searchWidget->isVisible()) {
+    updateMatches();
+  }
+}
+
+void SourceCodeEditor::showLargeFileViewer(bool p_show) {
+  if (!p_show) {
+    m_largeFileViewer->closeFile();
+  } else {
+    m_searchWidget->hide();
+  }
+  m_largeFileViewer->setVisible(p_show);
+  m_codeEditor->setVisible(!p_show);
+  m_methodsComboBox->setVisible(!p_show);
 }
 
@@ -5,6 +5,8 @@
 
 #include "ui_SourceCodeEditor.h"
 #include "Highlighter.hxx"
+#include "LargeFileViewer.hxx"
+#include "FindEngine.hxx"
 
 class SourceCodeEditor: public QWidget, protected Ui::SourceCodeEditor {
   Q_OBJECT
@@ -13,8 +15,13 @@ public:
   explicit SourceCodeEditor(QWidget* p_parent = nullptr);
   virtual ~SourceCodeEditor();
 
-  void openSourceCode(QString const& p_content, CodeEditor::FileType p_fileType);
+  void openSourceCode(QString const& p_content, FileTypes::FileType p_fileType, QString const& p_absoluteFilePath = QString());
+  /// Sets back the prepared document of a file shown lately, returns false if there is none
+  bool openCachedSourceCode(QString const& p_absoluteFilePath);
+  /// Maps a file too large for the code editor into a read-only viewer, returns false if it cannot be opened
+  bool openLargeFile(QString const& p_absoluteFilePath);
   void setFocusToSourceEditor();
+  void goToLineNumber(int p_lineNumber);
 
   void findTextInSourceEditor();
 
@@ -25,13 +32,20 @@ protected slots:
   void fillMethodsComboBox(const QMap<int, QString>& p_methodsAndIndex);
   void goToLine(int p_index);
   void overlineMatch(QString const& p_match);
+  void updateMatches();
   void moveCursorToNextMatch();
   void moveCursorToPreviousMatch();
 
 private:
+  void selectMatch(int p_match);
+  /// Searches the content of the document just shown from now on
+  void resetMatches();
+  void showLargeFileViewer(bool p_show);
+
   Highlighter* m_highlighters;
-  QVector<int> m_matchPositions;
-  int m_currentMatchPosition;
+  LargeFileViewer* m_largeFileViewer;
+  FindEngine m_findEngine;
+  int m_currentMatch;
 };
 
 #endif // SOURCECODEEDITOR_H
@@ -2,24 +2,21 @@
 
 #include <QDebug>
 
+#include "FileTypes.hxx"
+
 SourceFileSystemModel::SourceFileSystemModel(QObject* p_parent):
   QFileSystemModel(p_parent) {
 
   setFilter(QDir::Files | QDir::AllDirs | QDir::NoDotAndDotDot);
   setNameFilterDisables(false);
-  setNameFilters(QStringList() << "*.cpp" << "*.h");
+  setNameFilters(FileTypes::nameFilters());
 }
 
 QVariant SourceFileSystemModel::data(const QModelIndex& p_index, int p_role ) const {
-  if (p_role == Qt::DecorationRole) {
-    QFileInfo info = SourceFileSystemModel::fileInfo(p_index);
-
-    if(info.isFile()) {
-      if(info.suffix() == "cpp") {
-        return QPixmap("../QtSourceCodeBrowser/icons/cppFile.png");
-      } else if(info.suffix() == "h") {
-        return QPixmap("../QtSourceCodeBrowser/icons/hFile.png");
-      }
+  if (p_role == Qt::DecorationRole && p_index.column() == 0 && !isDir(p_index)) {
+    FileTypes::FileType fileType = FileTypes::fileType(fileName(p_index));
+    if (fileType != FileTypes::eOtherFile) {
+      return FileTypes::icon(fileType);
     }
   }
 
@@ -1,62 +1,34 @@
 #include "SourceFileSystemProxyModel.hxx"
 
-#include <QFileInfo>
-#include <QPixmap>
+#include <QFileSystemModel>
 #include <QDebug>
 
-SourceFileSystemProxyModel::SourceFileSystemProxyModel(QModelIndex const& p_rootIndex, QObject* parent) :
+SourceFileSystemProxyModel::SourceFileSystemProxyModel(QObject* parent) :
   QSortFilterProxyModel(parent),
-  m_rootIndex(p_rootIndex) {
-
-
-  setFilterCaseSensitivity(Qt::CaseInsensitive);
+  m_treeFilter() {
 }
 
-bool SourceFileSystemProxyModel::filterAcceptsRow(
-  int p_sourceRow, QModelIndex const& p_sourceParent) const {
-  QModelIndex index0 = sourceModel()->index(p_sourceRow, 0, p_sourceParent);
-
-  if (sourceModel()->hasChildren(index0)) {
-    bool matchRegExp = false;
-    filterAux(matchRegExp, p_sourceRow, p_sourceParent);
-    return matchRegExp;
+void SourceFileSystemProxyModel::setTreeFilter(SourceIndex const& p_sourceIndex, QString const& p_pattern, QRegExp::PatternSyntax p_patternSyntax) {
+  if (!m_treeFilter.isActive() && p_pattern.isEmpty()) {
+    return;
   }
 
-  return matchRegExp(p_sourceRow, p_sourceParent);
+  m_treeFilter.setPattern(p_sourceIndex, p_pattern, p_patternSyntax);
+  invalidateFilter();
 }
 
-void SourceFileSystemProxyModel::filterAux(bool& p_match, int p_sourceRow, QModelIndex const& p_sourceParent) const {
-  QModelIndex index0 = sourceModel()->index(p_sourceRow, 0, p_sourceParent);
-
-  if (matchRegExp(p_sourceRow, p_sourceParent)) {
-    p_match = true;
-    return;
-  } else {
-    for (int k = 0; k < sourceModel()->rowCount(index0); ++k) {
-      filterAux(p_match, k, index0);
-      if (p_match) {
-        return;
-      }
-    }
+bool SourceFileSystemProxyModel::filterAcceptsRow(
+  int p_sourceRow, QModelIndex const& p_sourceParent) const {
+  if (!m_treeFilter.isActive()) {
+    return true;
   }
-}
 
-bool SourceFileSystemProxyModel::matchRegExp(int p_sourceRow, QModelIndex const& p_sourceParent) const {
-  QModelIndex index = sourceModel()->index(p_sourceRow, 0, p_sourceParent);
-  return (sourceModel()->data(index).toString().contains(filterRegExp()));
-}
-
-QVariant SourceFileSystemProxyModel::data( const QModelIndex& index, int role ) const {
-  if (role == Qt::DecorationRole) {
-    QFileInfo info(index.data(Qt::ToolTipRole).toString());
+  QFileSystemModel const* model = dynamic_cast<QFileSystemModel const*>(sourceModel());
+  Q_ASSERT(model != nullptr);
+  QModelIndex index0 = model->index(p_sourceRow, 0, p_sourceParent);
 
-    if(info.isFile()) {
-      if(info.suffix() == "cpp")
-        return QPixmap("../QtSourceCodeBrowser/icons/cppFile.png");
-      else if(info.suffix() == "h")
-        return QPixmap("../QtSourceCodeBrowser/icons/hFile.png");
-    }
+  if (model->isDir(index0)) {
+    return m_treeFilter.acceptsDirectory(model->filePath(index0));
   }
-
-  return QSortFilterProxyModel::data(index, role);
+  return m_treeFilter.acceptsFile(model->fileName(index0));
 }
@@ -4,21 +4,25 @@
 #include <QSortFilterProxyModel>
 #include <QModelIndex>
 
+#include "SourceTreeFilter.hxx"
+
+/// Filters the source tree in place. Whether a directory holds a match is
+/// precomputed by SourceTreeFilter, so rows are accepted without walking nor
+/// populating their subtree.
 class SourceFileSystemProxyModel: public QSortFilterProxyModel {
   Q_OBJECT
 
 public:
-  explicit SourceFileSystemProxyModel(const QModelIndex& p_rootIndex, QObject* parent = nullptr);
+  explicit SourceFileSystemProxyModel(QObject* parent = nullptr);
+
+  void setTreeFilter(SourceIndex const& p_sourceIndex, QString const& p_pattern, QRegExp::PatternSyntax p_patternSyntax);
+  SourceTreeFilter const& treeFilter() const { return m_treeFilter; }
 
 protected:
   bool filterAcceptsRow(int p_sourceRow, QModelIndex const& p_sourceParent) const override;
-  QVariant data(const QModelIndex& index, int role) const override;
 
 private:
-  void filterAux(bool& p_match, int p_sourceRow, QModelIndex const& p_sourceParent) const;
-  bool matchRegExp(int p_sourceRow, QModelIndex const& p_sourceParent) const;
-
-  QModelIndex m_rootIndex;
+  SourceTreeFilter m_treeFilter;
 };
 
 #endif // SOURCEFILESYSTEMPROXYMODEL_HXX
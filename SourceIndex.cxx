@@ -0,0 +1,322 @@
+#include "SourceIndex.hxx"
+
+#include <QDir>
+
+SourceIndex::SourceIndex():
+  m_rootDirectoryName(),
+  m_names(),
+  m_nameIds(),
+  m_directoryParents(),
+  m_directoryNames(),
+  m_directoriesLastModified(),
+  m_directoryFileCounts(),
+  m_directoriesRemoved(),
+  m_directoryPaths(),
+  m_directoryIds(),
+  m_fileDirectories(),
+  m_fileNames(),
+  m_fileTypes(),
+  m_filesLastModified() {
+}
+
+void SourceIndex::clear(QString const& p_rootDirectoryName) {
+  m_rootDirectoryName = p_rootDirectoryName;
+
+  m_names.clear();
+  m_nameIds.clear();
+
+  m_directoryParents.clear();
+  m_directoryNames.clear();
+  m_directoriesLastModified.clear();
+  m_directoryFileCounts.clear();
+  m_directoriesRemoved.clear();
+  m_directoryPaths.clear();
+  m_directoryIds.clear();
+
+  m_fileDirectories.clear();
+  m_fileNames.clear();
+  m_fileTypes.clear();
+  m_filesLastModified.clear();
+
+  // The root directory is not named, its path is the root directory name
+  appendDirectory(-1, -1, m_rootDirectoryName, 0);
+}
+
+QString SourceIndex::absoluteFilePath(int p_fileId) const {
+  return m_directoryPaths.at(m_fileDirectories.at(p_fileId))+QDir::separator()+fileName(p_fileId);
+}
+
+int SourceIndex::directoryFileCount(QString const& p_absolutePath) const {
+  auto directory = m_directoryIds.constFind(p_absolutePath);
+  if (directory == m_directoryIds.constEnd()) {
+    return 0;
+  }
+  return m_directoryFileCounts.at(directory.value());
+}
+
+QHash<QString, qint64> SourceIndex::directoriesLastModified() const {
+  QHash<QString, qint64> directoriesLastModified;
+  directoriesLastModified.reserve(m_directoryIds.size());
+  for (int k = 0; k < directoryCount(); ++k) {
+    if (!m_directoriesRemoved.at(k)) {
+      directoriesLastModified.insert(m_directoryPaths.at(k), m_directoriesLastModified.at(k));
+    }
+  }
+  return directoriesLastModified;
+}
+
+SourceIndex::Delta SourceIndex::updateDirectories(QVector<IndexedDirectory> const& p_directories) {
+  Delta delta;
+
+  // Only the last listing of a directory counts when it appears several times
+  QVector<int> directoryIds(p_directories.size(), -1);
+  QHash<int, int> directoryPositions;
+  QHash<int, QHash<QString, int>> listedFiles;
+  for (int k = p_directories.size()-1; k >= 0; --k) {
+    IndexedDirectory const& directory = p_directories.at(k);
+    int id = directoryId(directory.absolutePath);
+    if (directoryPositions.contains(id)) {
+      continue;
+    }
+    directoryPositions.insert(id, k);
+    directoryIds[k] = id;
+    m_directoriesLastModified[id] = directory.lastModified;
+
+    // Directories already holding files are compared with their new listing
+    if (m_directoryFileCounts.at(id) > 0) {
+      QHash<QString, int>& directoryListedFiles = listedFiles[id];
+      directoryListedFiles.reserve(directory.fileNames.size());
+      for (int l = 0; l < directory.fileNames.size(); ++l) {
+        directoryListedFiles.insert(directory.fileNames.at(l), l);
+      }
+    }
+  }
+
+  // A single pass over the files for the whole batch, keep the files still there and drop the missing ones
+  if (!listedFiles.isEmpty()) {
+    QVector<bool> removedFiles(fileCount(), false);
+    int removedCount = 0;
+    for (int fileId = 0; fileId < fileCount(); ++fileId) {
+      auto directoryListedFiles = listedFiles.find(m_fileDirectories.at(fileId));
+      if (directoryListedFiles == listedFiles.end()) {
+        continue;
+      }
+
+      auto listedFile = directoryListedFiles.value().find(fileName(fileId));
+      if (listedFile == directoryListedFiles.value().end()) {
+        delta.removedFilePaths << absoluteFilePath(fileId);
+        removedFiles[fileId] = true;
+        ++removedCount;
+      } else {
+        IndexedDirectory const& directory = p_directories.at(directoryPositions.value(m_fileDirectories.at(fileId)));
+        qint64 lastModified = directory.filesLastModified.at(listedFile.value());
+        if (lastModified != m_filesLastModified.at(fileId)) {
+          delta.changedFilePaths << absoluteFilePath(fileId);
+          m_filesLastModified[fileId] = lastModified;
+        }
+        directoryListedFiles.value().erase(listedFile);
+      }
+    }
+
+    if (removedCount > 0) {
+      removeFiles(removedFiles, removedCount);
+    }
+  }
+
+  // Then append the new ones
+  for (int k = 0; k < p_directories.size(); ++k) {
+    int id = directoryIds.at(k);
+    if (id < 0) {
+      continue;
+    }
+
+    IndexedDirectory const& directory = p_directories.at(k);
+    auto directoryListedFiles = listedFiles.constFind(id);
+    for (int l = 0; l < directory.fileNames.size(); ++l) {
+      if (directoryListedFiles == listedFiles.constEnd() || directoryListedFiles.value().contains(directory.fileNames.at(l))) {
+        delta.addedFiles << fileCount();
+        appendFile(id, internName(directory.fileNames.at(l)), directory.filesLastModified.at(l));
+      }
+    }
+  }
+
+  return delta;
+}
+
+QStringList SourceIndex::removeDirectories(QStringList const& p_absolutePaths) {
+  QStringList removedFilePaths;
+
+  QVector<bool> removedDirectories(directoryCount(), false);
+  bool removedDirectoryFound = false;
+  for (QString const& absolutePath: p_absolutePaths) {
+    int directoryId = m_directoryIds.value(absolutePath, -1);
+    if (directoryId >= 0) {
+      removedDirectories[directoryId] = true;
+      removedDirectoryFound = true;
+    }
+  }
+  if (!removedDirectoryFound) {
+    return removedFilePaths;
+  }
+
+  // Parents have lower ids than their children, a single pass removes whole sub trees
+  int removedDirectoriesCount = 0;
+  for (int k = 0; k < directoryCount(); ++k) {
+    int parentId = m_directoryParents.at(k);
+    if (!removedDirectories.at(k) && (parentId < 0 || !removedDirectories.at(parentId))) {
+      continue;
+    }
+    removedDirectories[k] = true;
+    if (!m_directoriesRemoved.at(k)) {
+      m_directoriesRemoved[k] = true;
+      m_directoryIds.remove(m_directoryPaths.at(k));
+      ++removedDirectoriesCount;
+    }
+  }
+
+  if (removedDirectoriesCount == 0) {
+    return removedFilePaths;
+  }
+
+  QVector<bool> removedFiles(fileCount(), false);
+  int removedCount = 0;
+  for (int fileId = 0; fileId < fileCount(); ++fileId) {
+    if (removedDirectories.at(m_fileDirectories.at(fileId))) {
+      removedFilePaths << absoluteFilePath(fileId);
+      removedFiles[fileId] = true;
+      ++removedCount;
+    }
+  }
+
+  if (removedCount > 0) {
+    removeFiles(removedFiles, removedCount);
+  }
+
+  return removedFilePaths;
+}
+
+void SourceIndex::compactDirectories() {
+  // Kept directories stay in the same order, so that parents keep lower ids than their children
+  QVector<int> directoryIds(directoryCount(), -1);
+  int keptCount = 0;
+  for (int k = 0; k < directoryCount(); ++k) {
+    if (!m_directoriesRemoved.at(k)) {
+      directoryIds[k] = keptCount++;
+    }
+  }
+  if (keptCount == directoryCount()) {
+    return;
+  }
+
+  for (int k = 0; k < directoryCount(); ++k) {
+    int keptId = directoryIds.at(k);
+    if (keptId < 0) {
+      continue;
+    }
+    int parentId = m_directoryParents.at(k);
+    m_directoryParents[keptId] = parentId < 0 ? -1 : directoryIds.at(parentId);
+    m_directoryNames[keptId] = m_directoryNames.at(k);
+    m_directoriesLastModified[keptId] = m_directoriesLastModified.at(k);
+    m_directoryFileCounts[keptId] = m_directoryFileCounts.at(k);
+    m_directoriesRemoved[keptId] = false;
+    m_directoryPaths[keptId] = m_directoryPaths.at(k);
+  }
+  m_directoryParents.resize(keptCount);
+  m_directoryNames.resize(keptCount);
+  m_directoriesLastModified.resize(keptCount);
+  m_directoryFileCounts.resize(keptCount);
+  m_directoriesRemoved.resize(keptCount);
+  m_directoryPaths.resize(keptCount);
+
+  m_directoryIds.clear();
+  m_directoryIds.reserve(keptCount);
+  for (int k = 0; k < keptCount; ++k) {
+    m_directoryIds.insert(m_directoryPaths.at(k), k);
+  }
+
+  // Files of removed directories are gone already
+  for (int fileId = 0; fileId < fileCount(); ++fileId) {
+    m_fileDirectories[fileId] = directoryIds.at(m_fileDirectories.at(fileId));
+  }
+}
+
+
+/// Private
+
+int SourceIndex::internName(QString const& p_name) {
+  if (m_nameIds.size() != m_names.size()) {
+    m_nameIds.clear();
+    m_nameIds.reserve(m_names.size());
+    for (int k = 0; k < m_names.size(); ++k) {
+      m_nameIds.insert(m_names.at(k), k);
+    }
+  }
+
+  auto nameId = m_nameIds.constFind(p_name);
+  if (nameId != m_nameIds.constEnd()) {
+    return nameId.value();
+  }
+
+  m_names << p_name;
+  m_nameIds.insert(p_name, m_names.size()-1);
+  return m_names.size()-1;
+}
+
+int SourceIndex::directoryId(QString const& p_absolutePath) {
+  auto directory = m_directoryIds.constFind(p_absolutePath);
+  if (directory != m_directoryIds.constEnd()) {
+    return directory.value();
+  }
+
+  int separatorIndex = p_absolutePath.lastIndexOf(QDir::separator());
+  if (separatorIndex <= 0 || p_absolutePath.size() <= m_rootDirectoryName.size()) {
+    // Outside of the root directory, should not happen
+    return 0;
+  }
+
+  // Parents are created first so that a parent id is always lower than its children ids
+  int parentId = directoryId(p_absolutePath.left(separatorIndex));
+  return appendDirectory(parentId, internName(p_absolutePath.mid(separatorIndex+1)), p_absolutePath, 0);
+}
+
+int SourceIndex::appendDirectory(int p_parentId, int p_nameId, QString const& p_absolutePath, qint64 p_lastModified) {
+  m_directoryParents << p_parentId;
+  m_directoryNames << p_nameId;
+  m_directoriesLastModified << p_lastModified;
+  m_directoryFileCounts << 0;
+  m_directoriesRemoved << false;
+  m_directoryPaths << p_absolutePath;
+  m_directoryIds.insert(p_absolutePath, m_directoryPaths.size()-1);
+  return m_directoryPaths.size()-1;
+}
+
+void SourceIndex::appendFile(int p_directoryId, int p_nameId, qint64 p_lastModified) {
+  m_fileDirectories << p_directoryId;
+  m_fileNames << p_nameId;
+  m_fileTypes << quint8(FileTypes::fileType(m_names.at(p_nameId)));
+  m_filesLastModified << p_lastModified;
+  ++m_directoryFileCounts[p_directoryId];
+}
+
+void SourceIndex::removeFiles(QVector<bool> const& p_removedFiles, int p_removedCount) {
+  int keptFileId = 0;
+  for (int fileId = 0; fileId < fileCount(); ++fileId) {
+    if (p_removedFiles.at(fileId)) {
+      --m_directoryFileCounts[m_fileDirectories.at(fileId)];
+      continue;
+    }
+    if (keptFileId != fileId) {
+      m_fileDirectories[keptFileId] = m_fileDirectories.at(fileId);
+      m_fileNames[keptFileId] = m_fileNames.at(fileId);
+      m_fileTypes[keptFileId] = m_fileTypes.at(fileId);
+      m_filesLastModified[keptFileId] = m_filesLastModified.at(fileId);
+    }
+    ++keptFileId;
+  }
+
+  int newFileCount = fileCount()-p_removedCount;
+  m_fileDirectories.resize(newFileCount);
+  m_fileNames.resize(newFileCount);
+  m_fileTypes.resize(newFileCount);
+  m_filesLastModified.resize(newFileCount);
+}
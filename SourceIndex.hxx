@@ -0,0 +1,85 @@
+#ifndef SOURCEINDEX_HXX
+#define SOURCEINDEX_HXX
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+
+#include "SourceIndexer.hxx"
+#include "FileTypes.hxx"
+
+/// In-memory index of the source tree. Directory and file names are interned
+/// once in a shared table, directories reference their parent by id and files
+/// their directory by id, so the whole tree is a handful of flat arrays.
+class SourceIndex {
+  friend class SourceIndexSnapshot;
+
+public:
+  struct Delta {
+    QVector<int> addedFiles;
+    QStringList changedFilePaths;
+    QStringList removedFilePaths;
+  };
+
+  SourceIndex();
+
+  void clear(QString const& p_rootDirectoryName);
+  QString rootDirectoryName() const { return m_rootDirectoryName; }
+
+  int nameCount() const { return m_names.size(); }
+  QString name(int p_nameId) const { return m_names.at(p_nameId); }
+
+  int fileCount() const { return m_fileNames.size(); }
+  int fileNameId(int p_fileId) const { return m_fileNames.at(p_fileId); }
+  QString fileName(int p_fileId) const { return m_names.at(m_fileNames.at(p_fileId)); }
+  QString absoluteFilePath(int p_fileId) const;
+  int fileDirectory(int p_fileId) const { return m_fileDirectories.at(p_fileId); }
+  FileTypes::FileType fileType(int p_fileId) const { return FileTypes::FileType(m_fileTypes.at(p_fileId)); }
+  qint64 fileLastModified(int p_fileId) const { return m_filesLastModified.at(p_fileId); }
+
+  int directoryCount() const { return m_directoryPaths.size(); }
+  bool isDirectoryRemoved(int p_directoryId) const { return m_directoriesRemoved.at(p_directoryId); }
+  QString directoryPath(int p_directoryId) const { return m_directoryPaths.at(p_directoryId); }
+  int directoryParent(int p_directoryId) const { return m_directoryParents.at(p_directoryId); }
+  int directoryNameId(int p_directoryId) const { return m_directoryNames.at(p_directoryId); }
+  int findDirectory(QString const& p_absolutePath) const { return m_directoryIds.value(p_absolutePath, -1); }
+  qint64 directoryLastModified(int p_directoryId) const { return m_directoriesLastModified.at(p_directoryId); }
+  int directoryFileCount(QString const& p_absolutePath) const;
+  QHash<QString, qint64> directoriesLastModified() const;
+
+  Delta updateDirectories(QVector<IndexedDirectory> const& p_directories);
+  QStringList removeDirectories(QStringList const& p_absolutePaths);
+  /// Drops the records of removed directories, the ids of the following ones change
+  void compactDirectories();
+
+private:
+  int internName(QString const& p_name);
+  int directoryId(QString const& p_absolutePath);
+  int appendDirectory(int p_parentId, int p_nameId, QString const& p_absolutePath, qint64 p_lastModified);
+  void appendFile(int p_directoryId, int p_nameId, qint64 p_lastModified);
+  void removeFiles(QVector<bool> const& p_removedFiles, int p_removedCount);
+
+  QString m_rootDirectoryName;
+
+  // Interned names, the hash is only built when the index is first modified
+  QStringList m_names;
+  QHash<QString, int> m_nameIds;
+
+  // Directories, the root is always id 0 and a parent id is lower than its children ids
+  QVector<int> m_directoryParents;
+  QVector<int> m_directoryNames;
+  QVector<qint64> m_directoriesLastModified;
+  QVector<int> m_directoryFileCounts;
+  QVector<bool> m_directoriesRemoved;
+  QVector<QString> m_directoryPaths;
+  QHash<QString, int> m_directoryIds;
+
+  // Files
+  QVector<int> m_fileDirectories;
+  QVector<int> m_fileNames;
+  QVector<quint8> m_fileTypes;
+  QVector<qint64> m_filesLastModified;
+};
+
+#endif // SOURCEINDEX_HXX
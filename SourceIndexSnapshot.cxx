@@ -0,0 +1,232 @@
+#include "SourceIndexSnapshot.hxx"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QStandardPaths>
+#include <QDebug>
+
+#include <cstring>
+
+namespace {
+  quint32 const g_snapshotMagic = 0x51534349; // "QSCI"
+  quint32 const g_snapshotVersion = 3;
+
+  struct SnapshotHeader {
+    quint32 magic;
+    quint32 version;
+    quint32 rootDirectoryNameBytes;
+    quint32 namesCount;
+    quint32 namesBytes;
+    quint32 directoriesCount;
+    quint32 filesCount;
+    quint32 reserved;
+  };
+
+  struct SnapshotDirectory {
+    qint32 parent;
+    qint32 name;
+    qint64 lastModified;
+  };
+
+  struct SnapshotFile {
+    qint32 directory;
+    qint32 name;
+    qint64 lastModified;
+  };
+
+  qint64 alignedSize(qint64 p_size) {
+    return (p_size+7) & ~qint64(7);
+  }
+
+  void appendPadding(QByteArray& p_bytes) {
+    p_bytes.append(QByteArray(alignedSize(p_bytes.size())-p_bytes.size(), '\0'));
+  }
+
+  template <typename T>
+  void appendRaw(QByteArray& p_bytes, T const& p_value) {
+    p_bytes.append(reinterpret_cast<char const*>(&p_value), sizeof(T));
+  }
+}
+
+QString SourceIndexSnapshot::defaultFileName() {
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)+QDir::separator()+"sourceIndex.snapshot";
+}
+
+bool SourceIndexSnapshot::load(QString const& p_snapshotFileName, QString const& p_rootDirectoryName, SourceIndex& p_index) {
+  QFile snapshotFile(p_snapshotFileName);
+  if (!snapshotFile.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+
+  qint64 size = snapshotFile.size();
+  if (size < qint64(sizeof(SnapshotHeader))) {
+    return false;
+  }
+
+  uchar const* data = snapshotFile.map(0, size);
+  if (data == nullptr) {
+    return false;
+  }
+
+  SnapshotHeader header;
+  std::memcpy(&header, data, sizeof(SnapshotHeader));
+  if (header.magic != g_snapshotMagic || header.version != g_snapshotVersion) {
+    return false;
+  }
+
+  // Sections offsets, each section starts on a 8 bytes boundary
+  qint64 rootDirectoryNameOffset = sizeof(SnapshotHeader);
+  qint64 nameOffsetsOffset = alignedSize(rootDirectoryNameOffset+header.rootDirectoryNameBytes);
+  qint64 namesOffset = nameOffsetsOffset+(qint64(header.namesCount)+1)*sizeof(quint32);
+  qint64 directoriesOffset = alignedSize(namesOffset+header.namesBytes);
+  qint64 filesOffset = directoriesOffset+qint64(header.directoriesCount)*sizeof(SnapshotDirectory);
+  qint64 fileTypesOffset = filesOffset+qint64(header.filesCount)*sizeof(SnapshotFile);
+  if (fileTypesOffset+header.filesCount > size || header.directoriesCount == 0) {
+    return false;
+  }
+
+  QString rootDirectoryName = QString::fromUtf8(reinterpret_cast<char const*>(data+rootDirectoryNameOffset), header.rootDirectoryNameBytes);
+  if (rootDirectoryName != p_rootDirectoryName) {
+    return false;
+  }
+
+  // Names
+  QVector<quint32> nameOffsets(header.namesCount+1);
+  std::memcpy(nameOffsets.data(), data+nameOffsetsOffset, nameOffsets.size()*sizeof(quint32));
+  QStringList names;
+  names.reserve(header.namesCount);
+  for (quint32 k = 0; k < header.namesCount; ++k) {
+    if (nameOffsets.at(k) > nameOffsets.at(k+1) || nameOffsets.at(k+1) > header.namesBytes) {
+      return false;
+    }
+    names << QString::fromUtf8(reinterpret_cast<char const*>(data+namesOffset+nameOffsets.at(k)), nameOffsets.at(k+1)-nameOffsets.at(k));
+  }
+
+  SourceIndex index;
+  index.m_rootDirectoryName = rootDirectoryName;
+  index.m_names = names;
+
+  // Directories, parents always come before their children
+  SnapshotDirectory const* directories = reinterpret_cast<SnapshotDirectory const*>(data+directoriesOffset);
+  index.m_directoryParents.reserve(header.directoriesCount);
+  index.m_directoryNames.reserve(header.directoriesCount);
+  index.m_directoriesLastModified.reserve(header.directoriesCount);
+  index.m_directoryPaths.reserve(header.directoriesCount);
+  index.m_directoryIds.reserve(header.directoriesCount);
+  for (quint32 k = 0; k < header.directoriesCount; ++k) {
+    SnapshotDirectory directory;
+    std::memcpy(&directory, directories+k, sizeof(SnapshotDirectory));
+    QString absolutePath;
+    if (k == 0) {
+      absolutePath = rootDirectoryName;
+    } else if (directory.parent >= 0 && quint32(directory.parent) < k && directory.name >= 0 && quint32(directory.name) < header.namesCount) {
+      absolutePath = index.m_directoryPaths.at(directory.parent)+QDir::separator()+names.at(directory.name);
+    } else {
+      return false;
+    }
+    index.appendDirectory(k == 0 ? -1 : directory.parent, k == 0 ? -1 : directory.name, absolutePath, directory.lastModified);
+  }
+
+  // Files
+  SnapshotFile const* files = reinterpret_cast<SnapshotFile const*>(data+filesOffset);
+  uchar const* fileTypes = data+fileTypesOffset;
+  index.m_fileDirectories.resize(header.filesCount);
+  index.m_fileNames.resize(header.filesCount);
+  index.m_fileTypes.resize(header.filesCount);
+  index.m_filesLastModified.resize(header.filesCount);
+  for (quint32 k = 0; k < header.filesCount; ++k) {
+    SnapshotFile file;
+    std::memcpy(&file, files+k, sizeof(SnapshotFile));
+    if (file.directory < 0 || quint32(file.directory) >= header.directoriesCount || file.name < 0 || quint32(file.name) >= header.namesCount) {
+      return false;
+    }
+    index.m_fileDirectories[k] = file.directory;
+    index.m_fileNames[k] = file.name;
+    index.m_fileTypes[k] = fileTypes[k];
+    index.m_filesLastModified[k] = file.lastModified;
+    ++index.m_directoryFileCounts[file.directory];
+  }
+
+  snapshotFile.unmap(const_cast<uchar*>(data));
+  snapshotFile.close();
+
+  p_index = index;
+  return true;
+}
+
+bool SourceIndexSnapshot::save(QString const& p_snapshotFileName, SourceIndex const& p_index) {
+  if (p_index.directoryCount() == 0 || p_index.isDirectoryRemoved(0)) {
+    return false;
+  }
+
+  // Removed directories are not written, the others are renumbered in order
+  QVector<int> directoryIds(p_index.directoryCount(), -1);
+  quint32 directoriesCount = 0;
+  for (int k = 0; k < p_index.directoryCount(); ++k) {
+    if (!p_index.isDirectoryRemoved(k)) {
+      directoryIds[k] = directoriesCount++;
+    }
+  }
+
+  QByteArray rootDirectoryName = p_index.m_rootDirectoryName.toUtf8();
+  QByteArray names;
+  QVector<quint32> nameOffsets;
+  nameOffsets.reserve(p_index.m_names.size()+1);
+  for (QString const& name: p_index.m_names) {
+    nameOffsets << names.size();
+    names.append(name.toUtf8());
+  }
+  nameOffsets << names.size();
+
+  SnapshotHeader header;
+  header.magic = g_snapshotMagic;
+  header.version = g_snapshotVersion;
+  header.rootDirectoryNameBytes = rootDirectoryName.size();
+  header.namesCount = p_index.m_names.size();
+  header.namesBytes = names.size();
+  header.directoriesCount = directoriesCount;
+  header.filesCount = p_index.fileCount();
+  header.reserved = 0;
+
+  QByteArray bytes;
+  bytes.reserve(sizeof(SnapshotHeader)+rootDirectoryName.size()+nameOffsets.size()*sizeof(quint32)+names.size()
+    +directoriesCount*sizeof(SnapshotDirectory)+p_index.fileCount()*(sizeof(SnapshotFile)+1)+32);
+
+  appendRaw(bytes, header);
+  bytes.append(rootDirectoryName);
+  appendPadding(bytes);
+  bytes.append(reinterpret_cast<char const*>(nameOffsets.constData()), nameOffsets.size()*sizeof(quint32));
+  bytes.append(names);
+  appendPadding(bytes);
+
+  for (int k = 0; k < p_index.directoryCount(); ++k) {
+    if (directoryIds.at(k) < 0) {
+      continue;
+    }
+    SnapshotDirectory directory;
+    directory.parent = (k == 0) ? -1 : directoryIds.at(p_index.directoryParent(k));
+    directory.name = p_index.m_directoryNames.at(k);
+    directory.lastModified = p_index.directoryLastModified(k);
+    appendRaw(bytes, directory);
+  }
+
+  for (int k = 0; k < p_index.fileCount(); ++k) {
+    SnapshotFile file;
+    file.directory = directoryIds.at(p_index.fileDirectory(k));
+    file.name = p_index.m_fileNames.at(k);
+    file.lastModified = p_index.fileLastModified(k);
+    appendRaw(bytes, file);
+  }
+  bytes.append(reinterpret_cast<char const*>(p_index.m_fileTypes.constData()), p_index.fileCount());
+
+  QDir().mkpath(QFileInfo(p_snapshotFileName).absolutePath());
+  QSaveFile snapshotFile(p_snapshotFileName);
+  if (!snapshotFile.open(QIODevice::WriteOnly)) {
+    qDebug() << "Cannot write source index snapshot" << snapshotFile.errorString();
+    return false;
+  }
+  snapshotFile.write(bytes);
+  return snapshotFile.commit();
+}
@@ -0,0 +1,19 @@
+#ifndef SOURCEINDEXSNAPSHOT_HXX
+#define SOURCEINDEXSNAPSHOT_HXX
+
+#include <QString>
+
+#include "SourceIndex.hxx"
+
+/// Compact on-disk image of a SourceIndex: the interned names table followed
+/// by fixed-width directory and file records. Loading maps the file and copies
+/// the records straight into the index arrays, without touching the tree.
+class SourceIndexSnapshot {
+public:
+  static QString defaultFileName();
+
+  static bool load(QString const& p_snapshotFileName, QString const& p_rootDirectoryName, SourceIndex& p_index);
+  static bool save(QString const& p_snapshotFileName, SourceIndex const& p_index);
+};
+
+#endif // SOURCEINDEXSNAPSHOT_HXX
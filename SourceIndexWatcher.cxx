@@ -0,0 +1,198 @@
+#include "SourceIndexWatcher.hxx"
+
+#include <QSocketNotifier>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace {
+  int const g_quietIntervalMs = 250;
+  int const g_maximumLatencyMs = 2000;
+}
+
+SourceIndexWatcher::SourceIndexWatcher(QStringList const& p_nameFilters, QObject* p_parent):
+  QObject(p_parent),
+  m_inotifyFileDescriptor(-1),
+  m_watchLimitReached(false),
+  m_notifier(nullptr),
+  m_nameSuffixes(),
+  m_watchedPaths(),
+  m_watchDescriptors(),
+  m_changedDirectories(),
+  m_coalescingTimer(),
+  m_firstChangeTimer() {
+
+  for (QString nameFilter: p_nameFilters) {
+    m_nameSuffixes << nameFilter.remove('*');
+  }
+
+  m_coalescingTimer.setSingleShot(true);
+  m_coalescingTimer.setInterval(g_quietIntervalMs);
+  connect(&m_coalescingTimer, SIGNAL(timeout()), this, SLOT(emitChangedDirectories()));
+
+#ifdef Q_OS_LINUX
+  m_inotifyFileDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (m_inotifyFileDescriptor < 0) {
+    qDebug() << "inotify is not available, the source index will not follow file system changes";
+    return;
+  }
+
+  m_notifier = new QSocketNotifier(m_inotifyFileDescriptor, QSocketNotifier::Read, this);
+  connect(m_notifier, SIGNAL(activated(int)), this, SLOT(readEvents()));
+#endif
+}
+
+SourceIndexWatcher::~SourceIndexWatcher() {
+#ifdef Q_OS_LINUX
+  if (m_inotifyFileDescriptor >= 0) {
+    ::close(m_inotifyFileDescriptor);
+  }
+#endif
+}
+
+/// Public
+
+void SourceIndexWatcher::watchDirectory(QString const& p_absolutePath) {
+#ifdef Q_OS_LINUX
+  if (!isAvailable() || m_watchLimitReached || m_watchDescriptors.contains(p_absolutePath)) {
+    return;
+  }
+
+  // Files written in place change neither the listing nor the directory modification time,
+  // they are reported once closed rather than on every write
+  quint32 mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+  int watchDescriptor = inotify_add_watch(m_inotifyFileDescriptor, QFile::encodeName(p_absolutePath).constData(), mask);
+  if (watchDescriptor < 0) {
+    if (errno == ENOSPC) {
+      m_watchLimitReached = true;
+      qDebug() << "inotify watch limit reached after" << m_watchDescriptors.size() << "directories, raise fs.inotify.max_user_watches";
+    }
+    return;
+  }
+
+  // The same inode may already be watched under another path, keep the latest one
+  m_watchDescriptors.remove(m_watchedPaths.value(watchDescriptor));
+  m_watchedPaths.insert(watchDescriptor, p_absolutePath);
+  m_watchDescriptors.insert(p_absolutePath, watchDescriptor);
+#else
+  Q_UNUSED(p_absolutePath)
+#endif
+}
+
+void SourceIndexWatcher::unwatchDirectory(QString const& p_absolutePath) {
+#ifdef Q_OS_LINUX
+  QString subDirectoriesPrefix = p_absolutePath+QDir::separator();
+  for (auto watched = m_watchDescriptors.begin(); watched != m_watchDescriptors.end(); ) {
+    if (watched.key() == p_absolutePath || watched.key().startsWith(subDirectoriesPrefix)) {
+      inotify_rm_watch(m_inotifyFileDescriptor, watched.value());
+      m_watchedPaths.remove(watched.value());
+      watched = m_watchDescriptors.erase(watched);
+    } else {
+      ++watched;
+    }
+  }
+#else
+  Q_UNUSED(p_absolutePath)
+#endif
+}
+
+
+/// Private slots
+
+void SourceIndexWatcher::readEvents() {
+#ifdef Q_OS_LINUX
+  alignas(inotify_event) char buffer[64*1024];
+
+  forever {
+    ssize_t length = ::read(m_inotifyFileDescriptor, buffer, sizeof(buffer));
+    if (length <= 0) {
+      break;
+    }
+
+    for (char const* current = buffer; current < buffer+length; ) {
+      inotify_event const* event = reinterpret_cast<inotify_event const*>(current);
+      current += sizeof(inotify_event)+event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        m_changedDirectories.clear();
+        m_coalescingTimer.stop();
+        emit eventsOverflowed();
+        continue;
+      }
+
+      QString directoryPath = m_watchedPaths.value(event->wd);
+      if (directoryPath.isEmpty()) {
+        continue;
+      }
+
+      if (event->mask & IN_IGNORED) {
+        m_watchDescriptors.remove(directoryPath);
+        m_watchedPaths.remove(event->wd);
+        continue;
+      }
+
+      if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+        addChangedDirectory(directoryPath);
+        continue;
+      }
+
+      bool isDirectory = (event->mask & IN_ISDIR) != 0;
+      QString entryName = (event->len > 0) ? QFile::decodeName(event->name) : QString();
+      if (!isWatchedEntry(entryName, isDirectory)) {
+        continue;
+      }
+
+      addChangedDirectory(directoryPath);
+      if (isDirectory && (event->mask & (IN_DELETE | IN_MOVED_FROM))) {
+        // Listing the parent does not report gone sub directories, check them explicitly
+        addChangedDirectory(directoryPath+QDir::separator()+entryName);
+      }
+    }
+  }
+#endif
+}
+
+void SourceIndexWatcher::emitChangedDirectories() {
+  if (m_changedDirectories.isEmpty()) {
+    return;
+  }
+
+  QStringList changedDirectories = m_changedDirectories.toList();
+  m_changedDirectories.clear();
+  emit directoriesChanged(changedDirectories);
+}
+
+
+/// Private
+
+void SourceIndexWatcher::addChangedDirectory(QString const& p_absolutePath) {
+  if (m_changedDirectories.isEmpty()) {
+    m_firstChangeTimer.start();
+  }
+  m_changedDirectories.insert(p_absolutePath);
+
+  // Wait for the storm to calm down, but not forever
+  if (m_firstChangeTimer.elapsed() < g_maximumLatencyMs) {
+    m_coalescingTimer.start();
+  } else if (!m_coalescingTimer.isActive()) {
+    m_coalescingTimer.start();
+  }
+}
+
+bool SourceIndexWatcher::isWatchedEntry(QString const& p_entryName, bool p_isDirectory) const {
+  if (p_isDirectory) {
+    return true;
+  }
+  for (QString const& nameSuffix: m_nameSuffixes) {
+    if (p_entryName.endsWith(nameSuffix)) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,54 @@
+#ifndef SOURCEINDEXWATCHER_HXX
+#define SOURCEINDEXWATCHER_HXX
+
+#include <QObject>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
+
+class QSocketNotifier;
+
+/// Watches the indexed directories with inotify and reports which ones need
+/// to be listed again, entries having been added, removed or written in
+/// place. Events are coalesced: directoriesChanged() is emitted once the
+/// tree has been quiet for a little while, or at a bounded interval during
+/// long storms such as a branch checkout.
+class SourceIndexWatcher: public QObject {
+  Q_OBJECT
+
+public:
+  explicit SourceIndexWatcher(QStringList const& p_nameFilters, QObject* p_parent = nullptr);
+  ~SourceIndexWatcher();
+
+  bool isAvailable() const { return m_inotifyFileDescriptor >= 0; }
+  void watchDirectory(QString const& p_absolutePath);
+  void unwatchDirectory(QString const& p_absolutePath);
+
+signals:
+  void directoriesChanged(QStringList p_absolutePaths);
+  void eventsOverflowed();
+
+private slots:
+  void readEvents();
+  void emitChangedDirectories();
+
+private:
+  void addChangedDirectory(QString const& p_absolutePath);
+  bool isWatchedEntry(QString const& p_entryName, bool p_isDirectory) const;
+
+  int m_inotifyFileDescriptor;
+  bool m_watchLimitReached;
+  QSocketNotifier* m_notifier;
+  QStringList m_nameSuffixes;
+
+  QHash<int, QString> m_watchedPaths;
+  QHash<QString, int> m_watchDescriptors;
+
+  QSet<QString> m_changedDirectories;
+  QTimer m_coalescingTimer;
+  QElapsedTimer m_firstChangeTimer;
+};
+
+#endif // SOURCEINDEXWATCHER_HXX
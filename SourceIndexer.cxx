@@ -0,0 +1,285 @@
+#include "SourceIndexer.hxx"
+
+#include <QRunnable>
+#include <QThread>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include "FileTypes.hxx"
+
+namespace {
+  int const g_batchFilesCount = 512;
+  int const g_batchIntervalMs = 50;
+}
+
+class SourceIndexerWorker: public QRunnable {
+public:
+  SourceIndexerWorker(SourceIndexer* p_indexer, int p_workerId):
+    QRunnable(),
+    m_indexer(p_indexer),
+    m_workerId(p_workerId) {
+
+    setAutoDelete(true);
+  }
+
+  void run() override {
+    SourceIndexer::Batch batch;
+    batch.filesCount = 0;
+    QElapsedTimer flushTimer;
+    flushTimer.start();
+
+    SourceIndexer::DirectoryTask task;
+    while (m_indexer->m_cancelled.load() == 0) {
+      if (m_indexer->nextDirectory(m_workerId, task)) {
+        m_indexer->scanDirectory(m_workerId, task, batch);
+        if (batch.filesCount >= g_batchFilesCount || flushTimer.elapsed() > g_batchIntervalMs) {
+          m_indexer->flushBatch(batch);
+          flushTimer.restart();
+        }
+      } else if (m_indexer->m_pendingDirectories.load() == 0) {
+        break;
+      } else {
+        // Another worker is still listing a directory that may feed us
+        m_indexer->waitForDirectory();
+      }
+    }
+
+    m_indexer->flushBatch(batch);
+    m_indexer->workerFinished();
+  }
+
+private:
+  SourceIndexer* m_indexer;
+  int m_workerId;
+};
+
+
+SourceIndexer::SourceIndexer(QObject* p_parent):
+  QObject(p_parent),
+  m_threadPool(),
+  m_deques(),
+  m_nameFilters(sourceNameFilters()),
+  m_knownDirectories(),
+  m_idleMutex(),
+  m_directoryPushed(),
+  m_pendingDirectories(0),
+  m_runningWorkers(0),
+  m_cancelled(0),
+  m_filesCount(0),
+  m_directoriesCount(0) {
+
+  qRegisterMetaType<IndexedDirectory>("IndexedDirectory");
+  qRegisterMetaType<QVector<IndexedDirectory>>("QVector<IndexedDirectory>");
+  qRegisterMetaType<QStringList>("QStringList");
+}
+
+SourceIndexer::~SourceIndexer() {
+  cancel();
+  m_threadPool.waitForDone();
+  qDeleteAll(m_deques);
+}
+
+QStringList SourceIndexer::sourceNameFilters() {
+  return FileTypes::nameFilters();
+}
+
+/// Public
+
+void SourceIndexer::start(QString const& p_rootDirectoryName, QHash<QString, qint64> const& p_knownDirectories) {
+  // Known directories are checked, unknown ones are listed
+  QVector<DirectoryTask> tasks;
+  tasks.reserve(p_knownDirectories.size()+1);
+  for (auto knownDirectory = p_knownDirectories.constBegin(); knownDirectory != p_knownDirectories.constEnd(); ++knownDirectory) {
+    tasks << DirectoryTask{knownDirectory.key(), true};
+  }
+  if (!p_knownDirectories.contains(p_rootDirectoryName)) {
+    tasks << DirectoryTask{p_rootDirectoryName, false};
+  }
+
+  startTasks(tasks, p_knownDirectories);
+}
+
+void SourceIndexer::rescan(QStringList const& p_absolutePaths, QHash<QString, qint64> const& p_knownDirectories) {
+  QVector<DirectoryTask> tasks;
+  tasks.reserve(p_absolutePaths.size());
+  for (QString const& absolutePath: p_absolutePaths) {
+    tasks << DirectoryTask{absolutePath, false};
+  }
+
+  startTasks(tasks, p_knownDirectories);
+}
+
+void SourceIndexer::cancel() {
+  m_cancelled.store(1);
+  wakeIdleWorkers();
+}
+
+bool SourceIndexer::isRunning() const {
+  return m_runningWorkers.load() > 0;
+}
+
+
+/// Private
+
+void SourceIndexer::startTasks(QVector<DirectoryTask> const& p_tasks, QHash<QString, qint64> const& p_knownDirectories) {
+  if (isRunning()) {
+    cancel();
+    m_threadPool.waitForDone();
+  }
+
+  int workersCount = qMax(1, QThread::idealThreadCount());
+  qDeleteAll(m_deques);
+  m_deques.clear();
+  for (int k = 0; k < workersCount; ++k) {
+    m_deques << new DirectoryDeque;
+  }
+  m_threadPool.setMaxThreadCount(workersCount);
+
+  m_knownDirectories = p_knownDirectories;
+  m_cancelled.store(0);
+  m_filesCount.store(0);
+  m_directoriesCount.store(0);
+  m_runningWorkers.store(workersCount);
+
+  // Initial tasks are spread over the workers
+  for (int k = 0; k < p_tasks.size(); ++k) {
+    m_deques.at(k%workersCount)->push(p_tasks.at(k));
+  }
+  m_pendingDirectories.store(p_tasks.size());
+
+  for (int k = 0; k < workersCount; ++k) {
+    m_threadPool.start(new SourceIndexerWorker(this, k));
+  }
+}
+
+bool SourceIndexer::DirectoryDeque::popBack(DirectoryTask& p_task) {
+  QMutexLocker locker(&m_mutex);
+  if (m_tasks.isEmpty()) {
+    return false;
+  }
+  p_task = m_tasks.takeLast();
+  return true;
+}
+
+bool SourceIndexer::DirectoryDeque::stealFront(DirectoryTask& p_task) {
+  QMutexLocker locker(&m_mutex);
+  if (m_tasks.isEmpty()) {
+    return false;
+  }
+  p_task = m_tasks.takeFirst();
+  return true;
+}
+
+bool SourceIndexer::nextDirectory(int p_workerId, DirectoryTask& p_task) {
+  if (m_deques.at(p_workerId)->popBack(p_task)) {
+    return true;
+  }
+
+  // Steal the oldest, hence shallowest and biggest, pending directory of a victim
+  int dequesCount = m_deques.size();
+  for (int k = 1; k < dequesCount; ++k) {
+    if (m_deques.at((p_workerId+k)%dequesCount)->stealFront(p_task)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void SourceIndexer::scanDirectory(int p_workerId, DirectoryTask const& p_task, Batch& p_batch) {
+  QFileInfo directoryInfo(p_task.absolutePath);
+
+  if (!directoryInfo.isDir()) {
+    p_batch.removedDirectories << p_task.absolutePath;
+    endDirectory();
+    return;
+  }
+  if (p_task.checkOnly && directoryInfo.lastModified().toMSecsSinceEpoch() == m_knownDirectories.value(p_task.absolutePath)) {
+    endDirectory();
+    return;
+  }
+
+  QDir directory(p_task.absolutePath);
+  QFileInfoList entries = directory.entryInfoList(m_nameFilters, QDir::AllDirs | QDir::Files | QDir::NoDotAndDotDot);
+
+  IndexedDirectory indexedDirectory;
+  indexedDirectory.absolutePath = p_task.absolutePath;
+  indexedDirectory.lastModified = directoryInfo.lastModified().toMSecsSinceEpoch();
+  bool subDirectoryPushed = false;
+
+  for (QFileInfo const& entry: entries) {
+    if (entry.isDir()) {
+      // Known sub directories already have their own task
+      QString subDirectoryName = p_task.absolutePath+QDir::separator()+entry.fileName();
+      if (!m_knownDirectories.contains(subDirectoryName)) {
+        m_pendingDirectories.ref();
+        m_deques.at(p_workerId)->push(DirectoryTask{subDirectoryName, false});
+        subDirectoryPushed = true;
+      }
+    } else {
+      indexedDirectory.fileNames << entry.fileName();
+      indexedDirectory.filesLastModified << entry.lastModified().toMSecsSinceEpoch();
+    }
+  }
+
+  p_batch.filesCount += indexedDirectory.fileNames.size();
+  m_filesCount.fetchAndAddRelaxed(indexedDirectory.fileNames.size());
+  m_directoriesCount.ref();
+  p_batch.directories << indexedDirectory;
+
+  if (subDirectoryPushed) {
+    wakeIdleWorkers();
+  }
+  endDirectory();
+}
+
+void SourceIndexer::endDirectory() {
+  // Idle workers leave once the last directory is listed
+  if (!m_pendingDirectories.deref()) {
+    wakeIdleWorkers();
+  }
+}
+
+void SourceIndexer::waitForDirectory() {
+  // Checked again under the lock, so that a directory pushed meanwhile does not go unnoticed
+  QMutexLocker locker(&m_idleMutex);
+  if (m_cancelled.load() != 0 || m_pendingDirectories.load() == 0) {
+    return;
+  }
+  for (DirectoryDeque* deque: m_deques) {
+    if (!deque->isEmpty()) {
+      return;
+    }
+  }
+  m_directoryPushed.wait(&m_idleMutex);
+}
+
+void SourceIndexer::wakeIdleWorkers() {
+  QMutexLocker locker(&m_idleMutex);
+  m_directoryPushed.wakeAll();
+}
+
+void SourceIndexer::flushBatch(Batch& p_batch) {
+  if (m_cancelled.load() == 0) {
+    if (!p_batch.directories.isEmpty()) {
+      emit directoriesIndexed(p_batch.directories);
+      emit indexingProgress(m_filesCount.load(), m_directoriesCount.load());
+    }
+    if (!p_batch.removedDirectories.isEmpty()) {
+      emit directoriesRemoved(p_batch.removedDirectories);
+    }
+  }
+
+  p_batch.directories.clear();
+  p_batch.removedDirectories.clear();
+  p_batch.filesCount = 0;
+}
+
+void SourceIndexer::workerFinished() {
+  if (m_runningWorkers.fetchAndAddOrdered(-1) == 1 && m_cancelled.load() == 0) {
+    emit indexingFinished(m_filesCount.load());
+  }
+}
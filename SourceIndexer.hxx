@@ -0,0 +1,106 @@
+#ifndef SOURCEINDEXER_HXX
+#define SOURCEINDEXER_HXX
+
+#include <QObject>
+#include <QThreadPool>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QMetaType>
+
+struct IndexedDirectory {
+  QString absolutePath;
+  qint64 lastModified;
+  QStringList fileNames;
+  QVector<qint64> filesLastModified;
+};
+
+Q_DECLARE_METATYPE(IndexedDirectory)
+Q_DECLARE_METATYPE(QVector<IndexedDirectory>)
+
+class SourceIndexerWorker;
+
+/// Walks a source tree on a pool of worker threads. Each worker owns a deque of
+/// directories to scan: it pops from the back of its own deque and steals from
+/// the front of the others when it runs dry, sleeping while the others may
+/// still push sub directories. Scanned directories are streamed back to the
+/// GUI thread in batches through directoriesIndexed().
+///
+/// When known directories are given, they are only listed again if their last
+/// modification time changed, and the ones that disappeared are reported
+/// through directoriesRemoved(). rescan() lists the given directories again
+/// whatever their modification time.
+class SourceIndexer: public QObject {
+  Q_OBJECT
+
+  friend class SourceIndexerWorker;
+
+public:
+  explicit SourceIndexer(QObject* p_parent = nullptr);
+  ~SourceIndexer();
+
+  static QStringList sourceNameFilters();
+
+  void start(QString const& p_rootDirectoryName, QHash<QString, qint64> const& p_knownDirectories = QHash<QString, qint64>());
+  void rescan(QStringList const& p_absolutePaths, QHash<QString, qint64> const& p_knownDirectories);
+  void cancel();
+  bool isRunning() const;
+
+signals:
+  void directoriesIndexed(QVector<IndexedDirectory> p_directories);
+  void directoriesRemoved(QStringList p_absolutePaths);
+  void indexingProgress(int p_filesCount, int p_directoriesCount);
+  void indexingFinished(int p_filesCount);
+
+private:
+  struct DirectoryTask {
+    QString absolutePath;
+    bool checkOnly;
+  };
+
+  struct Batch {
+    QVector<IndexedDirectory> directories;
+    QStringList removedDirectories;
+    int filesCount;
+  };
+
+  class DirectoryDeque {
+  public:
+    void push(DirectoryTask const& p_task) { QMutexLocker locker(&m_mutex); m_tasks.append(p_task); }
+    bool popBack(DirectoryTask& p_task);
+    bool stealFront(DirectoryTask& p_task);
+    bool isEmpty() { QMutexLocker locker(&m_mutex); return m_tasks.isEmpty(); }
+
+  private:
+    QMutex m_mutex;
+    QVector<DirectoryTask> m_tasks;
+  };
+
+  void startTasks(QVector<DirectoryTask> const& p_tasks, QHash<QString, qint64> const& p_knownDirectories);
+  bool nextDirectory(int p_workerId, DirectoryTask& p_task);
+  void scanDirectory(int p_workerId, DirectoryTask const& p_task, Batch& p_batch);
+  void endDirectory();
+  void waitForDirectory();
+  void wakeIdleWorkers();
+  void flushBatch(Batch& p_batch);
+  void workerFinished();
+
+  QThreadPool m_threadPool;
+  QVector<DirectoryDeque*> m_deques;
+  QStringList m_nameFilters;
+  QHash<QString, qint64> m_knownDirectories;
+  /// Idle workers wait on m_directoryPushed until a directory is pushed or the last one is listed
+  QMutex m_idleMutex;
+  QWaitCondition m_directoryPushed;
+
+  QAtomicInt m_pendingDirectories;
+  QAtomicInt m_runningWorkers;
+  QAtomicInt m_cancelled;
+  QAtomicInt m_filesCount;
+  QAtomicInt m_directoriesCount;
+};
+
+#endif // SOURCEINDEXER_HXX
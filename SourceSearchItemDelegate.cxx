@@ -0,0 +1,53 @@
+#include "SourceSearchItemDelegate.hxx"
+
+#include <QApplication>
+#include <QPainter>
+#include <QTextLayout>
+
+#include "SourceSearchModel.hxx"
+
+SourceSearchItemDelegate::SourceSearchItemDelegate(QObject* p_parent):
+  QStyledItemDelegate(p_parent) {
+}
+
+void SourceSearchItemDelegate::paint(QPainter* p_painter, QStyleOptionViewItem const& p_option, QModelIndex const& p_index) const {
+  QVariantList spans = p_index.data(SourceSearchModel::MatchSpansRole).toList();
+  if (spans.isEmpty()) {
+    QStyledItemDelegate::paint(p_painter, p_option, p_index);
+    return;
+  }
+
+  QStyleOptionViewItem option = p_option;
+  initStyleOption(&option, p_index);
+  QStyle* style = option.widget != nullptr ? option.widget->style() : QApplication::style();
+
+  // Background, selection and icon from the style, then the text by hand
+  QRect textRect = style->subElementRect(QStyle::SE_ItemViewItemText, &option, option.widget);
+  int textMargin = style->pixelMetric(QStyle::PM_FocusFrameHMargin, nullptr, option.widget)+1;
+  QString text = option.text;
+  option.text.clear();
+  style->drawControl(QStyle::CE_ItemViewItem, &option, p_painter, option.widget);
+
+  QList<QTextLayout::FormatRange> formats;
+  for (int k = 0; k+1 < spans.size(); k += 2) {
+    QTextLayout::FormatRange range;
+    range.start = spans.at(k).toInt();
+    range.length = spans.at(k+1).toInt();
+    range.format.setFontWeight(QFont::Bold);
+    formats << range;
+  }
+
+  QTextLayout layout(text, option.font);
+  layout.setAdditionalFormats(formats);
+  layout.beginLayout();
+  QTextLine line = layout.createLine();
+  line.setLineWidth(textRect.width()-2*textMargin);
+  layout.endLayout();
+
+  p_painter->save();
+  QPalette::ColorGroup colorGroup = (option.state & QStyle::State_Enabled) ? QPalette::Normal : QPalette::Disabled;
+  p_painter->setPen(option.palette.color(colorGroup, (option.state & QStyle::State_Selected) ? QPalette::HighlightedText : QPalette::Text));
+  p_painter->setClipRect(textRect);
+  layout.draw(p_painter, QPointF(textRect.left()+textMargin, textRect.top()+(textRect.height()-line.height())/2));
+  p_painter->restore();
+}
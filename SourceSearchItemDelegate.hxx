@@ -0,0 +1,16 @@
+#ifndef SOURCESEARCHITEMDELEGATE_HXX
+#define SOURCESEARCHITEMDELEGATE_HXX
+
+#include <QStyledItemDelegate>
+
+/// Draws the file names of the search list with their matched characters in bold.
+class SourceSearchItemDelegate: public QStyledItemDelegate {
+  Q_OBJECT
+
+public:
+  explicit SourceSearchItemDelegate(QObject* p_parent = nullptr);
+
+  void paint(QPainter* p_painter, QStyleOptionViewItem const& p_option, QModelIndex const& p_index) const override;
+};
+
+#endif // SOURCESEARCHITEMDELEGATE_HXX
@@ -0,0 +1,265 @@
+#include "SourceSearchModel.hxx"
+
+#include <QSet>
+#include <QRegExp>
+
+#include "SourceIndexSnapshot.hxx"
+
+namespace {
+  int const g_searchDelayMs = 30;
+}
+
+SourceSearchModel::SourceSearchModel(SourceIndex* p_sourceIndex, QObject* p_parent):
+  QAbstractListModel(p_parent),
+  m_sourceIndex(p_sourceIndex),
+  m_sourceSearcher(nullptr),
+  m_searchTimer(),
+  m_searching(false),
+  m_searchQuery(),
+  m_searchMode(SourceSearcher::eFuzzySearch),
+  m_searchRegExp(),
+  m_searchGeneration(-1),
+  m_pendingSearchIndex(),
+  m_searchIndex(),
+  m_searchResults(),
+  m_keystrokeTimer(),
+  m_searchLatencyPending(false),
+  m_searchLatency{0, 0, 0, 0} {
+
+  m_sourceSearcher = new SourceSearcher(this);
+  connect(m_sourceSearcher, SIGNAL(searchFinished(int,QVector<int>)), this, SLOT(applySearchResults(int,QVector<int>)));
+
+  // Keystrokes are coalesced until typing pauses
+  m_searchTimer.setSingleShot(true);
+  m_searchTimer.setInterval(g_searchDelayMs);
+  connect(&m_searchTimer, SIGNAL(timeout()), this, SLOT(startSearch()));
+}
+
+/// Public
+
+int SourceSearchModel::rowCount(QModelIndex const& p_parent) const {
+  if (p_parent.isValid()) {
+    return 0;
+  }
+  return m_searching ? m_searchResults.size() : m_sourceIndex->fileCount();
+}
+
+QVariant SourceSearchModel::data(QModelIndex const& p_index, int p_role) const {
+  if (!p_index.isValid() || p_index.row() >= rowCount()) {
+    return QVariant();
+  }
+
+  SourceIndex const& sourceIndex = rowsIndex();
+  int id = fileId(p_index.row());
+  switch (p_role) {
+  case Qt::DisplayRole: {
+    return sourceIndex.fileName(id);
+  }
+  case Qt::ToolTipRole: {
+    return sourceIndex.absoluteFilePath(id);
+  }
+  case Qt::DecorationRole: {
+    return FileTypes::icon(sourceIndex.fileType(id));
+  }
+  case MatchSpansRole: {
+    QVariantList spans;
+    if (!m_searching) {
+      return spans;
+    }
+    if (m_searchMode == SourceSearcher::eRegExpSearch) {
+      int position = m_searchRegExp.indexIn(sourceIndex.fileName(id));
+      if (position >= 0 && m_searchRegExp.matchedLength() > 0) {
+        spans << position << m_searchRegExp.matchedLength();
+      }
+    } else {
+      for (int bound: FuzzyFileFinder::matchSpans(sourceIndex.fileName(id), m_searchQuery)) {
+        spans << bound;
+      }
+    }
+    return spans;
+  }
+  default: {
+    return QVariant();
+  }
+  }
+}
+
+Qt::ItemFlags SourceSearchModel::flags(QModelIndex const& p_index) const {
+  if (!p_index.isValid()) {
+    return Qt::NoItemFlags;
+  }
+  return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+
+bool SourceSearchModel::loadSnapshot(QString const& p_snapshotFileName, QString const& p_rootDirectoryName) {
+  beginResetModel();
+  m_sourceSearcher->clear();
+  m_searchGeneration = -1;
+  bool loaded = SourceIndexSnapshot::load(p_snapshotFileName, p_rootDirectoryName, *m_sourceIndex);
+  m_searchIndex = SourceIndex();
+  m_searchResults.clear();
+  endResetModel();
+
+  scheduleSearch();
+  return loaded;
+}
+
+void SourceSearchModel::clear(QString const& p_rootDirectoryName) {
+  beginResetModel();
+  m_sourceSearcher->clear();
+  m_searchGeneration = -1;
+  m_sourceIndex->clear(p_rootDirectoryName);
+  m_searchIndex = SourceIndex();
+  m_searchResults.clear();
+  endResetModel();
+
+  scheduleSearch();
+}
+
+SourceIndex::Delta SourceSearchModel::updateDirectories(QVector<IndexedDirectory> const& p_directories) {
+  // Search results keep showing their own copy of the index, they are refreshed by a new search
+  if (m_searching) {
+    SourceIndex::Delta delta = m_sourceIndex->updateDirectories(p_directories);
+    scheduleSearch();
+    return delta;
+  }
+
+  // Listing again a directory that already holds files may remove some, the rows are then reset
+  QSet<QString> directories;
+  int addedFilesCount = 0;
+  bool mayRemoveFiles = false;
+  for (int k = p_directories.size()-1; k >= 0; --k) {
+    IndexedDirectory const& directory = p_directories.at(k);
+    if (directories.contains(directory.absolutePath)) {
+      continue;
+    }
+    directories.insert(directory.absolutePath);
+    addedFilesCount += directory.fileNames.size();
+    mayRemoveFiles = mayRemoveFiles || m_sourceIndex->directoryFileCount(directory.absolutePath) > 0;
+  }
+
+  SourceIndex::Delta delta;
+  if (mayRemoveFiles) {
+    beginResetModel();
+    delta = m_sourceIndex->updateDirectories(p_directories);
+    endResetModel();
+  } else if (addedFilesCount > 0) {
+    int fileCount = m_sourceIndex->fileCount();
+    beginInsertRows(QModelIndex(), fileCount, fileCount+addedFilesCount-1);
+    delta = m_sourceIndex->updateDirectories(p_directories);
+    endInsertRows();
+  } else {
+    delta = m_sourceIndex->updateDirectories(p_directories);
+  }
+
+  scheduleSearch();
+  return delta;
+}
+
+QStringList SourceSearchModel::removeDirectories(QStringList const& p_absolutePaths) {
+  if (m_searching) {
+    QStringList removedFilePaths = m_sourceIndex->removeDirectories(p_absolutePaths);
+    scheduleSearch();
+    return removedFilePaths;
+  }
+
+  beginResetModel();
+  QStringList removedFilePaths = m_sourceIndex->removeDirectories(p_absolutePaths);
+  endResetModel();
+
+  scheduleSearch();
+  return removedFilePaths;
+}
+
+void SourceSearchModel::setSearchQuery(QString const& p_query, SourceSearcher::SearchMode p_searchMode) {
+  setQuery(p_query, p_searchMode);
+
+  m_keystrokeTimer.start();
+  m_searchLatencyPending = true;
+  m_searchTimer.start();
+}
+
+void SourceSearchModel::searchNow(QString const& p_query, SourceSearcher::SearchMode p_searchMode) {
+  setQuery(p_query, p_searchMode);
+
+  m_searchTimer.stop();
+  m_searchLatencyPending = false;
+  m_searchGeneration = -1;
+
+  SourceIndex searchIndex = *m_sourceIndex;
+  setSearchResults(searchIndex, m_sourceSearcher->searchNow(searchIndex, m_searchQuery, m_searchMode));
+}
+
+
+/// Private slots
+
+void SourceSearchModel::startSearch() {
+  if (m_searchQuery.isEmpty()) {
+    m_sourceSearcher->cancel();
+    m_searchGeneration = -1;
+    setSearchResults(SourceIndex(), QVector<int>());
+    recordSearchLatency();
+    return;
+  }
+
+  // Copied here, the worker reads this copy while the index keeps being updated
+  m_pendingSearchIndex = *m_sourceIndex;
+  m_searchGeneration = m_sourceSearcher->search(m_pendingSearchIndex, m_searchQuery, m_searchMode);
+}
+
+void SourceSearchModel::applySearchResults(int p_generation, QVector<int> const& p_fileIds) {
+  // Results of a cancelled search may still be queued
+  if (p_generation != m_searchGeneration) {
+    return;
+  }
+
+  setSearchResults(m_pendingSearchIndex, p_fileIds);
+  m_pendingSearchIndex = SourceIndex();
+  m_searchGeneration = -1;
+  recordSearchLatency();
+}
+
+
+/// Private
+
+void SourceSearchModel::setQuery(QString const& p_query, SourceSearcher::SearchMode p_searchMode) {
+  m_searchQuery = p_query;
+  m_searchMode = p_searchMode;
+
+  // Compiled once for the spans of every row painted
+  if (m_searchMode == SourceSearcher::eRegExpSearch) {
+    m_searchRegExp = QRegExp(m_searchQuery, Qt::CaseInsensitive);
+  } else {
+    m_searchRegExp = QRegExp();
+  }
+}
+
+void SourceSearchModel::setSearchResults(SourceIndex const& p_searchIndex, QVector<int> const& p_fileIds) {
+  beginResetModel();
+  m_searching = true;
+  m_searchIndex = p_searchIndex;
+  m_searchResults = p_fileIds;
+  endResetModel();
+}
+
+void SourceSearchModel::scheduleSearch() {
+  // Index changes do not delay a search already waiting for typing to pause
+  bool searchPending = m_searchGeneration >= 0;
+  if ((m_searching || searchPending) && !m_searchTimer.isActive()) {
+    m_searchTimer.start();
+  }
+}
+
+void SourceSearchModel::recordSearchLatency() {
+  if (!m_searchLatencyPending) {
+    return;
+  }
+  m_searchLatencyPending = false;
+
+  qint64 latency = m_keystrokeTimer.elapsed();
+  ++m_searchLatency.count;
+  m_searchLatency.last = latency;
+  m_searchLatency.maximum = qMax(m_searchLatency.maximum, latency);
+  m_searchLatency.total += latency;
+  emit searchLatencyRecorded();
+}
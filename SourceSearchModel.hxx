@@ -0,0 +1,91 @@
+#ifndef SOURCESEARCHMODEL_HXX
+#define SOURCESEARCHMODEL_HXX
+
+#include <QAbstractListModel>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QRegExp>
+
+#include "SourceIndex.hxx"
+#include "SourceSearcher.hxx"
+
+/// Read-only list of the indexed source files. Rows are the SourceIndex file
+/// ids, so names and paths are read straight from its interned arrays. Every
+/// change of the index goes through this model so that whole batches are
+/// announced with a single beginInsertRows() or model reset.
+///
+/// Once a search query is set, rows are its results instead. Searches run on
+/// a worker thread over a copy of the index, which the results then keep
+/// showing until the next ones replace them in a single model reset.
+class SourceSearchModel: public QAbstractListModel {
+  Q_OBJECT
+
+public:
+  enum Roles {
+    /// Matched ranges of the file name, start and length pairs
+    MatchSpansRole = Qt::UserRole+1
+  };
+
+  /// Keystroke to results latencies, in milliseconds
+  struct SearchLatency {
+    int count;
+    qint64 last;
+    qint64 maximum;
+    qint64 total;
+  };
+
+  explicit SourceSearchModel(SourceIndex* p_sourceIndex, QObject* p_parent = nullptr);
+
+  int rowCount(QModelIndex const& p_parent = QModelIndex()) const override;
+  QVariant data(QModelIndex const& p_index, int p_role = Qt::DisplayRole) const override;
+  Qt::ItemFlags flags(QModelIndex const& p_index) const override;
+
+  SourceIndex const* sourceIndex() const { return m_sourceIndex; }
+
+  bool loadSnapshot(QString const& p_snapshotFileName, QString const& p_rootDirectoryName);
+  void clear(QString const& p_rootDirectoryName);
+  SourceIndex::Delta updateDirectories(QVector<IndexedDirectory> const& p_directories);
+  QStringList removeDirectories(QStringList const& p_absolutePaths);
+
+  /// Searches once typing pauses, an empty query has no result
+  void setSearchQuery(QString const& p_query, SourceSearcher::SearchMode p_searchMode);
+  /// Searches right away, for callers that read the rows just after
+  void searchNow(QString const& p_query, SourceSearcher::SearchMode p_searchMode);
+  bool isSearching() const { return m_searching; }
+  SearchLatency searchLatency() const { return m_searchLatency; }
+
+signals:
+  /// Emitted once the results of a typed query are shown
+  void searchLatencyRecorded();
+
+private slots:
+  void startSearch();
+  void applySearchResults(int p_generation, QVector<int> const& p_fileIds);
+
+private:
+  SourceIndex const& rowsIndex() const { return m_searching ? m_searchIndex : *m_sourceIndex; }
+  int fileId(int p_row) const { return m_searching ? m_searchResults.at(p_row) : p_row; }
+  void setQuery(QString const& p_query, SourceSearcher::SearchMode p_searchMode);
+  void setSearchResults(SourceIndex const& p_searchIndex, QVector<int> const& p_fileIds);
+  void scheduleSearch();
+  void recordSearchLatency();
+
+  SourceIndex* m_sourceIndex;
+  SourceSearcher* m_sourceSearcher;
+  QTimer m_searchTimer;
+
+  bool m_searching;
+  QString m_searchQuery;
+  SourceSearcher::SearchMode m_searchMode;
+  QRegExp m_searchRegExp;
+  int m_searchGeneration;
+  SourceIndex m_pendingSearchIndex;
+  SourceIndex m_searchIndex;
+  QVector<int> m_searchResults;
+
+  QElapsedTimer m_keystrokeTimer;
+  bool m_searchLatencyPending;
+  SearchLatency m_searchLatency;
+};
+
+#endif // SOURCESEARCHMODEL_HXX
@@ -0,0 +1,122 @@
+#include "SourceSearcher.hxx"
+
+#include <QRunnable>
+#include <QRegExp>
+
+namespace {
+  int const g_maximumFuzzyResultCount = 1000;
+  int const g_cancellationCheckMask = 0xfff;
+}
+
+class SourceSearchWorker: public QRunnable {
+public:
+  SourceSearchWorker(SourceSearcher* p_searcher, SourceIndex const& p_sourceIndex, QString const& p_query, SourceSearcher::SearchMode p_searchMode, int p_generation):
+    QRunnable(),
+    m_searcher(p_searcher),
+    m_sourceIndex(p_sourceIndex),
+    m_query(p_query),
+    m_searchMode(p_searchMode),
+    m_generation(p_generation) {
+
+    setAutoDelete(true);
+  }
+
+  void run() override {
+    QVector<int> fileIds = m_searcher->runSearch(m_sourceIndex, m_query, m_searchMode, m_generation);
+    if (m_searcher->m_generation.load() == m_generation) {
+      emit m_searcher->searchFinished(m_generation, fileIds);
+    }
+  }
+
+private:
+  SourceSearcher* m_searcher;
+  SourceIndex m_sourceIndex;
+  QString m_query;
+  SourceSearcher::SearchMode m_searchMode;
+  int m_generation;
+};
+
+
+SourceSearcher::SourceSearcher(QObject* p_parent):
+  QObject(p_parent),
+  m_threadPool(),
+  m_generation(0),
+  m_fuzzyFileFinderMutex(),
+  m_fuzzyFileFinder() {
+
+  // Searches run one after the other, a newer one only waits for the older to give up
+  m_threadPool.setMaxThreadCount(1);
+
+  qRegisterMetaType<QVector<int>>("QVector<int>");
+}
+
+SourceSearcher::~SourceSearcher() {
+  cancel();
+  m_threadPool.waitForDone();
+}
+
+/// Public
+
+int SourceSearcher::search(SourceIndex const& p_sourceIndex, QString const& p_query, SearchMode p_searchMode) {
+  // The index is copied here, in the thread that modifies it, so that the worker reads an unchanging one
+  int generation = m_generation.fetchAndAddOrdered(1)+1;
+  m_threadPool.clear();
+  m_threadPool.start(new SourceSearchWorker(this, p_sourceIndex, p_query, p_searchMode, generation));
+  return generation;
+}
+
+QVector<int> SourceSearcher::searchNow(SourceIndex const& p_sourceIndex, QString const& p_query, SearchMode p_searchMode) {
+  int generation = m_generation.fetchAndAddOrdered(1)+1;
+  m_threadPool.clear();
+  return runSearch(p_sourceIndex, p_query, p_searchMode, generation);
+}
+
+void SourceSearcher::cancel() {
+  m_generation.fetchAndAddOrdered(1);
+  m_threadPool.clear();
+}
+
+void SourceSearcher::clear() {
+  cancel();
+  QMutexLocker locker(&m_fuzzyFileFinderMutex);
+  m_fuzzyFileFinder.clear();
+}
+
+
+/// Private
+
+QVector<int> SourceSearcher::runSearch(SourceIndex const& p_sourceIndex, QString const& p_query, SearchMode p_searchMode, int p_generation) {
+  QMutexLocker locker(&m_fuzzyFileFinderMutex);
+  if (m_generation.load() != p_generation) {
+    return QVector<int>();
+  }
+
+  if (p_searchMode == eRegExpSearch) {
+    return regExpSearch(p_sourceIndex, p_query, p_generation);
+  }
+  return m_fuzzyFileFinder.search(p_sourceIndex, p_query, g_maximumFuzzyResultCount, m_generation, p_generation);
+}
+
+QVector<int> SourceSearcher::regExpSearch(SourceIndex const& p_sourceIndex, QString const& p_query, int p_generation) const {
+  QVector<int> fileIds;
+  if (p_query.isEmpty()) {
+    return fileIds;
+  }
+
+  // Interned names are matched once, then files are listed in index order
+  QRegExp regExp(p_query, Qt::CaseInsensitive);
+  QVector<bool> matchedNames(p_sourceIndex.nameCount(), false);
+  for (int nameId = 0; nameId < p_sourceIndex.nameCount(); ++nameId) {
+    if ((nameId & g_cancellationCheckMask) == 0 && m_generation.load() != p_generation) {
+      return QVector<int>();
+    }
+    matchedNames[nameId] = p_sourceIndex.name(nameId).contains(regExp);
+  }
+
+  for (int fileId = 0; fileId < p_sourceIndex.fileCount(); ++fileId) {
+    if (matchedNames.at(p_sourceIndex.fileNameId(fileId))) {
+      fileIds << fileId;
+    }
+  }
+  return fileIds;
+}
@@ -0,0 +1,53 @@
+#ifndef SOURCESEARCHER_HXX
+#define SOURCESEARCHER_HXX
+
+#include <QObject>
+#include <QThreadPool>
+#include <QMutex>
+#include <QAtomicInt>
+
+#include "SourceIndex.hxx"
+#include "FuzzyFileFinder.hxx"
+
+/// Searches copies of the source index on a worker thread. Every search gets a
+/// new generation, which cancels the previous one: it is dropped if still
+/// queued, and gives up early if already running. Only the results of the
+/// latest generation are reported.
+class SourceSearcher: public QObject {
+  Q_OBJECT
+
+  friend class SourceSearchWorker;
+
+public:
+  enum SearchMode {
+    eFuzzySearch = 0,
+    eRegExpSearch
+  };
+
+  explicit SourceSearcher(QObject* p_parent = nullptr);
+  ~SourceSearcher();
+
+  /// Starts searching, returns the generation reported with the results
+  int search(SourceIndex const& p_sourceIndex, QString const& p_query, SearchMode p_searchMode);
+  /// Same in the calling thread, for callers that need the results right away
+  QVector<int> searchNow(SourceIndex const& p_sourceIndex, QString const& p_query, SearchMode p_searchMode);
+  void cancel();
+  /// To call when the source index has been replaced
+  void clear();
+
+signals:
+  void searchFinished(int p_generation, QVector<int> p_fileIds);
+
+private:
+  QVector<int> runSearch(SourceIndex const& p_sourceIndex, QString const& p_query, SearchMode p_searchMode, int p_generation);
+  QVector<int> regExpSearch(SourceIndex const& p_sourceIndex, QString const& p_query, int p_generation) const;
+
+  QThreadPool m_threadPool;
+  QAtomicInt m_generation;
+
+  // Keeps its caches between searches, one search at a time
+  QMutex m_fuzzyFileFinderMutex;
+  FuzzyFileFinder m_fuzzyFileFinder;
+};
+
+#endif // SOURCESEARCHER_HXX
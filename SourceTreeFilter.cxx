@@ -0,0 +1,79 @@
+#include "SourceTreeFilter.hxx"
+
+#include <QDir>
+
+SourceTreeFilter::SourceTreeFilter():
+  m_sourceIndex(),
+  m_regExp(),
+  m_directoriesMatched(),
+  m_matchedFileCount(0) {
+}
+
+/// Public
+
+void SourceTreeFilter::setPattern(SourceIndex const& p_sourceIndex, QString const& p_pattern, QRegExp::PatternSyntax p_patternSyntax) {
+  m_sourceIndex = p_sourceIndex;
+  m_regExp = QRegExp(p_pattern, Qt::CaseInsensitive, p_patternSyntax);
+  m_directoriesMatched.clear();
+  m_matchedFileCount = 0;
+  if (!isActive()) {
+    return;
+  }
+
+  // Interned names are matched once, for files and directories alike
+  QVector<bool> namesMatched(m_sourceIndex.nameCount(), false);
+  for (int nameId = 0; nameId < m_sourceIndex.nameCount(); ++nameId) {
+    namesMatched[nameId] = m_sourceIndex.name(nameId).contains(m_regExp);
+  }
+
+  m_directoriesMatched.fill(false, m_sourceIndex.directoryCount());
+  for (int fileId = 0; fileId < m_sourceIndex.fileCount(); ++fileId) {
+    if (namesMatched.at(m_sourceIndex.fileNameId(fileId))) {
+      m_directoriesMatched[m_sourceIndex.fileDirectory(fileId)] = true;
+      ++m_matchedFileCount;
+    }
+  }
+
+  // Parent ids are lower than their children ids, a single reverse pass carries the matches up to the root
+  for (int directoryId = m_sourceIndex.directoryCount()-1; directoryId > 0; --directoryId) {
+    if (m_sourceIndex.isDirectoryRemoved(directoryId)) {
+      m_directoriesMatched[directoryId] = false;
+      continue;
+    }
+    if (namesMatched.at(m_sourceIndex.directoryNameId(directoryId))) {
+      m_directoriesMatched[directoryId] = true;
+    }
+    if (m_directoriesMatched.at(directoryId)) {
+      m_directoriesMatched[m_sourceIndex.directoryParent(directoryId)] = true;
+    }
+  }
+}
+
+bool SourceTreeFilter::acceptsDirectory(QString const& p_absolutePath) const {
+  if (!isActive()) {
+    return true;
+  }
+
+  // The root directory and what lies outside of it are always kept, so that the tree root stays reachable
+  QString const& rootDirectoryName = m_sourceIndex.rootDirectoryName();
+  if (!p_absolutePath.startsWith(rootDirectoryName+QDir::separator())) {
+    return true;
+  }
+
+  int directoryId = m_sourceIndex.findDirectory(p_absolutePath);
+  return directoryId >= 0 && m_directoriesMatched.at(directoryId);
+}
+
+bool SourceTreeFilter::acceptsFile(QString const& p_fileName) const {
+  return !isActive() || p_fileName.contains(m_regExp);
+}
+
+QStringList SourceTreeFilter::matchedDirectories() const {
+  QStringList matchedDirectories;
+  for (int directoryId = 1; directoryId < m_directoriesMatched.size(); ++directoryId) {
+    if (m_directoriesMatched.at(directoryId)) {
+      matchedDirectories << m_sourceIndex.directoryPath(directoryId);
+    }
+  }
+  return matchedDirectories;
+}
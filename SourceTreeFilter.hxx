@@ -0,0 +1,35 @@
+#ifndef SOURCETREEFILTER_HXX
+#define SOURCETREEFILTER_HXX
+
+#include <QRegExp>
+#include <QVector>
+
+#include "SourceIndex.hxx"
+
+/// Tells which rows of the source tree to keep for a file name pattern. Names
+/// are matched once, then a single bottom-up pass over the directories of the
+/// source index marks every directory whose subtree holds a match, so that
+/// filtering a row never looks at its children.
+class SourceTreeFilter {
+public:
+  SourceTreeFilter();
+
+  /// An empty pattern keeps every row
+  void setPattern(SourceIndex const& p_sourceIndex, QString const& p_pattern, QRegExp::PatternSyntax p_patternSyntax);
+  bool isActive() const { return !m_regExp.isEmpty(); }
+
+  bool acceptsDirectory(QString const& p_absolutePath) const;
+  bool acceptsFile(QString const& p_fileName) const;
+
+  int matchedFileCount() const { return m_matchedFileCount; }
+  /// Directories holding a match in their subtree, parents first
+  QStringList matchedDirectories() const;
+
+private:
+  SourceIndex m_sourceIndex;
+  QRegExp m_regExp;
+  QVector<bool> m_directoriesMatched;
+  int m_matchedFileCount;
+};
+
+#endif // SOURCETREEFILTER_HXX
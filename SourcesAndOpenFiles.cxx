@@ -3,10 +3,28 @@
 #include <QSettings>
 #include <QInputDialog>
 #include <QMenu>
+#include <QStyle>
+#include <QSignalBlocker>
 #include <QDebug>
 
+#include "SourceIndexSnapshot.hxx"
+
+namespace {
+  int const g_maximumExpandedDirectoryCount = 100;
+  /// Most time the snapshot and the content index may lag behind the watched changes
+  int const g_indexUpdateSaveDelayMs = 10000;
+}
+
 SourcesAndOpenFiles::SourcesAndOpenFiles(QWidget* p_parent):
-  QWidget(p_parent) {
+  QWidget(p_parent),
+  m_sourceIndex(),
+  m_sourceIndexModified(false),
+  m_pendingChangedDirectories(),
+  m_checkAllDirectoriesPending(false),
+  m_changedSourceFilePaths(),
+  m_removedSourceFilePaths(),
+  m_indexUpdateSaveTimer(),
+  m_symbolIndex() {
 
   setupUi(this);
 
@@ -29,31 +47,94 @@ SourcesAndOpenFiles::SourcesAndOpenFiles(QWidget* p_parent):
   // Search Line Edit
   connect(m_searchLineEdit, SIGNAL(textChanged(QString)), this, SLOT(searchFiles(QString)));
 
-  // File System Model
+  // File System Model, filtered in place by the tree proxy model
   m_sourceModel = new SourceFileSystemModel(this);
   m_sourceRootIndex = m_sourceModel->setRootPath(m_rootDirectoryName);
+  m_sourceTreeProxyModel = new SourceFileSystemProxyModel(this);
+  m_sourceTreeProxyModel->setSourceModel(m_sourceModel);
 
   // Source Tree View
-  m_sourcesTreeView->setModel(m_sourceModel);
-  m_sourcesTreeView->setRootIndex(m_sourceRootIndex);
+  m_sourcesTreeView->setModel(m_sourceTreeProxyModel);
+  m_sourcesTreeView->setRootIndex(m_sourceTreeProxyModel->mapFromSource(m_sourceRootIndex));
   m_sourcesTreeView->setHeaderHidden(true);
-  connect(m_sourcesTreeView, SIGNAL(doubleClicked(QModelIndex)), this, SIGNAL(openSourceCodeFromTreeViewRequested(QModelIndex)));
-  connect(m_sourcesTreeView, SIGNAL(activated(QModelIndex)), this, SIGNAL(openSourceCodeFromTreeViewRequested(QModelIndex)));
+  connect(m_sourcesTreeView, SIGNAL(doubleClicked(QModelIndex)), this, SLOT(openSourceCodeFromTreeView(QModelIndex)));
+  connect(m_sourcesTreeView, SIGNAL(activated(QModelIndex)), this, SLOT(openSourceCodeFromTreeView(QModelIndex)));
 
   // Source Search Model
-  m_sourceSearchModel = new OpenDocumentsModel(this);
-  fillSourceModelFromSettingsDirectory(m_rootDirectoryName);
+  m_sourceSearchModel = new SourceSearchModel(&m_sourceIndex, this);
+  connect(m_sourceSearchModel, SIGNAL(searchLatencyRecorded()), this, SLOT(showSearchLatency()));
+
+  // Source Indexer, fills the search model in the background
+  m_sourceIndexer = new SourceIndexer(this);
+  connect(m_sourceIndexer, SIGNAL(directoriesIndexed(QVector<IndexedDirectory>)), this, SLOT(insertIndexedDirectories(QVector<IndexedDirectory>)));
+  connect(m_sourceIndexer, SIGNAL(directoriesRemoved(QStringList)), this, SLOT(removeIndexedDirectories(QStringList)));
+  connect(m_sourceIndexer, SIGNAL(indexingProgress(int,int)), this, SLOT(updateIndexingProgress(int,int)));
+  connect(m_sourceIndexer, SIGNAL(indexingFinished(int)), this, SLOT(endIndexing(int)));
+  updateIndexingProgress(0, 0);
+
+  // Source Index Watcher, changed directories are listed again by a second indexer
+  m_sourceIndexWatcher = new SourceIndexWatcher(SourceIndexer::sourceNameFilters(), this);
+  m_sourceIndexUpdater = new SourceIndexer(this);
+  connect(m_sourceIndexWatcher, SIGNAL(directoriesChanged(QStringList)), this, SLOT(updateChangedDirectories(QStringList)));
+  connect(m_sourceIndexWatcher, SIGNAL(eventsOverflowed()), this, SLOT(checkAllDirectories()));
+  connect(m_sourceIndexUpdater, SIGNAL(directoriesIndexed(QVector<IndexedDirectory>)), this, SLOT(insertIndexedDirectories(QVector<IndexedDirectory>)));
+  connect(m_sourceIndexUpdater, SIGNAL(directoriesRemoved(QStringList)), this, SLOT(removeIndexedDirectories(QStringList)));
+  connect(m_sourceIndexUpdater, SIGNAL(indexingFinished(int)), this, SLOT(endIndexUpdate(int)));
+  m_indexUpdateSaveTimer.setSingleShot(true);
+  m_indexUpdateSaveTimer.setInterval(g_indexUpdateSaveDelayMs);
+  connect(&m_indexUpdateSaveTimer, SIGNAL(timeout()), this, SLOT(saveIndexUpdates()));
+
+  // Previous session snapshot makes the search usable right away, then only changed directories are rescanned
+  if (m_sourceSearchModel->loadSnapshot(SourceIndexSnapshot::defaultFileName(), m_rootDirectoryName)) {
+    for (int k = 0; k < m_sourceIndex.directoryCount(); ++k) {
+      if (!m_sourceIndex.isDirectoryRemoved(k)) {
+        m_sourceIndexWatcher->watchDirectory(m_sourceIndex.directoryPath(k));
+      }
+    }
 
-  // Source Search Proxy model
-  m_sourceFileSystemProxyModel = new SourceFileSystemProxyModel(QModelIndex());
-  m_sourceFileSystemProxyModel->setSourceModel(m_sourceSearchModel);
+    m_sourceIndexer->start(m_rootDirectoryName, m_sourceIndex.directoriesLastModified());
+  } else {
+    m_sourceSearchModel->clear(m_rootDirectoryName);
+    m_sourceIndexer->start(m_rootDirectoryName);
+  }
 
-  // Source Search List View
-  m_sourceSearchView->setModel(m_sourceFileSystemProxyModel);
+  // Source Search List View, fuzzy search by default
+  m_sourceSearchView->setModel(m_sourceSearchModel);
+  m_sourceSearchView->setItemDelegate(new SourceSearchItemDelegate(this));
+  m_sourceSearchView->setUniformItemSizes(true);
   connect(m_sourceSearchView, SIGNAL(clicked(QModelIndex)), this, SIGNAL(openSourceCodeFromSearchRequested(QModelIndex)));
   connect(m_sourceSearchView, SIGNAL(clicked(QModelIndex)), this, SLOT(expandTreeView(QModelIndex)));
   connect(m_openDocumentsView, SIGNAL(clicked(QModelIndex)), this, SLOT(expandTreeView(QModelIndex)));
 
+  // Search mode
+  m_regExpSearchAction = m_searchLineEdit->addAction(style()->standardIcon(QStyle::SP_FileDialogDetailedView), QLineEdit::TrailingPosition);
+  m_regExpSearchAction->setCheckable(true);
+  m_regExpSearchAction->setToolTip("Regular expression search");
+  connect(m_regExpSearchAction, SIGNAL(toggled(bool)), this, SLOT(setRegExpSearch(bool)));
+  m_treeFilterAction = m_searchLineEdit->addAction(style()->standardIcon(QStyle::SP_DirIcon), QLineEdit::TrailingPosition);
+  m_treeFilterAction->setCheckable(true);
+  m_treeFilterAction->setToolTip("Filter the source tree");
+  connect(m_treeFilterAction, SIGNAL(toggled(bool)), this, SLOT(setTreeFilterMode(bool)));
+  m_grepAction = m_searchLineEdit->addAction(style()->standardIcon(QStyle::SP_FileDialogContentsView), QLineEdit::TrailingPosition);
+  m_grepAction->setCheckable(true);
+  m_grepAction->setToolTip("Search in file contents");
+  connect(m_grepAction, SIGNAL(toggled(bool)), this, SLOT(setGrepMode(bool)));
+
+  // Grep Results View, an extra page of the sources stack
+  m_grepResultsModel = new GrepResultsModel(&m_sourceIndex, this);
+  m_grepResultsView = new QListView(this);
+  m_grepResultsView->setModel(m_grepResultsModel);
+  m_grepResultsView->setItemDelegate(new SourceSearchItemDelegate(this));
+  m_grepResultsView->setUniformItemSizes(true);
+  m_sourcesStackedWidget->addWidget(m_grepResultsView);
+  connect(m_grepResultsView, SIGNAL(clicked(QModelIndex)), this, SIGNAL(openSourceCodeFromGrepRequested(QModelIndex)));
+  connect(m_grepResultsView, SIGNAL(activated(QModelIndex)), this, SIGNAL(openSourceCodeFromGrepRequested(QModelIndex)));
+  m_grepResultsModel->loadContentIndex();
+
+  // Symbol Indexer, definitions are parsed again once the tree is indexed
+  m_symbolIndexer = new SymbolIndexer(this);
+  connect(m_symbolIndexer, SIGNAL(symbolsIndexed(SymbolIndex)), this, SLOT(updateSymbolIndex(SymbolIndex)));
+
   // Show only first column
   for (int k = 1; k < m_sourceModel->columnCount(); ++k)
     m_sourcesTreeView->hideColumn(k);
@@ -115,6 +196,17 @@ void SourcesAndOpenFiles::clearOpenDocument() {
   m_openDocumentsModel->closeAllOpenDocument();
 }
 
+bool SourcesAndOpenFiles::findSymbolDefinition(QString const& p_symbol, QString& p_absoluteFilePath, int& p_lineNumber) const {
+  SymbolIndex::Definition definition;
+  if (!m_symbolIndex.findDefinition(p_symbol, definition)) {
+    return false;
+  }
+
+  p_absoluteFilePath = definition.absoluteFilePath;
+  p_lineNumber = definition.lineNumber;
+  return true;
+}
+
 
 /// Public slots
 
@@ -134,7 +226,14 @@ void SourcesAndOpenFiles::addOrRemoveStarToOpenDocument(QString const& p_fileNam
 }
 
 void SourcesAndOpenFiles::openSourceCodeFromFileName(const QString& p_fileName) {
-  m_searchLineEdit->setText("^"+p_fileName.toLower()+"(_p)?\\.");
+  // The menu is filled from the results, they are needed right away
+  QString searchQuery = "^"+p_fileName.toLower()+"(_p)?\\.";
+  {
+    QSignalBlocker blocker(m_searchLineEdit);
+    m_searchLineEdit->setText(searchQuery);
+  }
+  m_sourceSearchModel->searchNow(searchQuery, SourceSearcher::eRegExpSearch);
+  m_sourcesStackedWidget->setCurrentWidget(m_sourceSearchView->parentWidget());
   QMenu contextMenu(tr("Context menu"), this);
   contextMenu.setStyleSheet("QMenu { menu-scrollable: 1; }");
 
@@ -143,11 +242,7 @@ void SourcesAndOpenFiles::openSourceCodeFromFileName(const QString& p_fileName)
     QAction* action = new QAction(sourceFileName, this);
     connect(action, SIGNAL(triggered()), this, SLOT(openSourceCodeFromMenu()));
     contextMenu.addAction(action);
-    if (sourceFileName.endsWith(".cpp")) {
-      action->setIcon(QIcon("../QtSourceCodeBrowser/icons/cppFile.png"));
-    } else if (sourceFileName.endsWith(".h")) {
-      action->setIcon(QIcon("../QtSourceCodeBrowser/icons/hFile.png"));
-    }
+    action->setIcon(FileTypes::icon(FileTypes::fileType(sourceFileName)));
     m_actionSourcesMap.insert(action, m_sourceSearchView->model()->index(k, 0));
   }
   contextMenu.exec(cursor().pos());
@@ -158,13 +253,53 @@ void SourcesAndOpenFiles::openSourceCodeFromFileName(const QString& p_fileName)
 /// Protected slots
 
 void SourcesAndOpenFiles::searchFiles(QString const& p_fileName) {
-  if (p_fileName.isEmpty() && m_sourcesStackedWidget->currentWidget() != m_sourcesTreeView->parentWidget()) {
-    m_sourcesStackedWidget->setCurrentWidget(m_sourcesTreeView->parentWidget());
-  } else if (!p_fileName.isEmpty() && m_sourcesStackedWidget->currentWidget() != m_sourceSearchView->parentWidget()) {
-    m_sourcesStackedWidget->setCurrentWidget(m_sourceSearchView->parentWidget());
+  if (m_grepAction->isChecked()) {
+    if (m_sourcesStackedWidget->currentWidget() != m_grepResultsView) {
+      m_sourcesStackedWidget->setCurrentWidget(m_grepResultsView);
+    }
+    m_grepResultsModel->setPattern(p_fileName, m_regExpSearchAction->isChecked());
+    return;
+  }
+
+  // Either the tree is filtered in place, or the matches are listed
+  bool treeFilterMode = m_treeFilterAction->isChecked();
+  QWidget* currentWidget = (p_fileName.isEmpty() || treeFilterMode) ? m_sourcesTreeView->parentWidget() : m_sourceSearchView->parentWidget();
+  if (m_sourcesStackedWidget->currentWidget() != currentWidget) {
+    m_sourcesStackedWidget->setCurrentWidget(currentWidget);
+  }
+
+  filterTreeView(treeFilterMode ? p_fileName : QString());
+
+  // Filtering runs on a worker thread once typing pauses
+  m_sourceSearchModel->setSearchQuery(treeFilterMode ? QString() : p_fileName, m_regExpSearchAction->isChecked() ? SourceSearcher::eRegExpSearch : SourceSearcher::eFuzzySearch);
+}
+
+void SourcesAndOpenFiles::setRegExpSearch(bool p_regExpSearch) {
+  Q_UNUSED(p_regExpSearch)
+  searchFiles(m_searchLineEdit->text());
+}
+
+void SourcesAndOpenFiles::setTreeFilterMode(bool p_treeFilterMode) {
+  Q_UNUSED(p_treeFilterMode)
+  searchFiles(m_searchLineEdit->text());
+}
+
+void SourcesAndOpenFiles::setGrepMode(bool p_grepMode) {
+  // File name searches and tree filters are reset, they would otherwise keep running behind the matches
+  if (p_grepMode) {
+    filterTreeView(QString());
+    m_sourceSearchModel->setSearchQuery(QString(), SourceSearcher::eFuzzySearch);
+    m_searchLineEdit->setPlaceholderText("Text in source files");
+  } else {
+    m_grepResultsModel->clear();
+    m_searchLineEdit->setPlaceholderText("Source file");
   }
+  m_treeFilterAction->setEnabled(!p_grepMode);
+  searchFiles(m_searchLineEdit->text());
+}
 
-  m_sourceFileSystemProxyModel->setFilterRegExp(p_fileName);
+void SourcesAndOpenFiles::openSourceCodeFromTreeView(QModelIndex const& p_index) {
+  emit openSourceCodeFromTreeViewRequested(m_sourceTreeProxyModel->mapToSource(p_index));
 }
 
 void SourcesAndOpenFiles::sortOpenDocuments(QModelIndex, int, int) {
@@ -188,22 +323,154 @@ void SourcesAndOpenFiles::expandTreeView(const QModelIndex& p_index) {
   QString absolutePath = p_index.data(Qt::ToolTipRole).toString();
 
   m_searchLineEdit->clear();
-  m_sourcesTreeView->setCurrentIndex(m_sourceModel->index(absolutePath));
+  m_sourcesTreeView->setCurrentIndex(m_sourceTreeProxyModel->mapFromSource(m_sourceModel->index(absolutePath)));
+}
+
+void SourcesAndOpenFiles::insertIndexedDirectories(QVector<IndexedDirectory> const& p_directories) {
+  SourceIndex::Delta delta = m_sourceSearchModel->updateDirectories(p_directories);
+
+  // Files to parse again for their symbols, the whole tree is parsed once the first indexing ends
+  if (!m_sourceIndexer->isRunning()) {
+    for (int fileId: delta.addedFiles) {
+      m_changedSourceFilePaths << m_sourceIndex.absoluteFilePath(fileId);
+    }
+    m_changedSourceFilePaths += delta.changedFilePaths;
+    m_removedSourceFilePaths += delta.removedFilePaths;
+  }
+
+  watchIndexedDirectories(p_directories);
+  m_sourceIndexModified = true;
+}
+
+void SourcesAndOpenFiles::removeIndexedDirectories(QStringList const& p_absolutePaths) {
+  QStringList removedFilePaths = m_sourceSearchModel->removeDirectories(p_absolutePaths);
+  if (!m_sourceIndexer->isRunning()) {
+    m_removedSourceFilePaths += removedFilePaths;
+  }
+
+  for (QString const& absolutePath: p_absolutePaths) {
+    m_sourceIndexWatcher->unwatchDirectory(absolutePath);
+  }
+  m_sourceIndexModified = true;
+}
+
+void SourcesAndOpenFiles::updateIndexingProgress(int p_filesCount, int p_directoriesCount) {
+  m_searchLineEdit->setPlaceholderText(QString("Source file (indexing... %1 files in %2 directories)").arg(p_filesCount).arg(p_directoriesCount));
+}
+
+void SourcesAndOpenFiles::endIndexing(int p_filesCount) {
+  Q_UNUSED(p_filesCount)
+  m_searchLineEdit->setPlaceholderText("Source file");
+
+  // The tree filter works on a copy of the index, it now misses the new directories
+  if (m_treeFilterAction->isChecked()) {
+    filterTreeView(m_searchLineEdit->text());
+  }
+
+  saveSourceIndexSnapshot();
+  m_grepResultsModel->updateContentIndex();
+  m_changedSourceFilePaths.clear();
+  m_removedSourceFilePaths.clear();
+  m_symbolIndexer->start(m_sourceIndex);
+}
+
+void SourcesAndOpenFiles::updateChangedDirectories(QStringList const& p_absolutePaths) {
+  for (QString const& absolutePath: p_absolutePaths) {
+    m_pendingChangedDirectories.insert(absolutePath);
+  }
+
+  // Changes that arrive while updating wait for the current update to end
+  if (m_sourceIndexUpdater->isRunning()) {
+    return;
+  }
+
+  QStringList changedDirectories = m_pendingChangedDirectories.toList();
+  m_pendingChangedDirectories.clear();
+  m_sourceIndexUpdater->rescan(changedDirectories, m_sourceIndex.directoriesLastModified());
+}
+
+void SourcesAndOpenFiles::checkAllDirectories() {
+  // Some events have been lost, fall back to comparing every directory modification time
+  if (m_sourceIndexUpdater->isRunning()) {
+    m_checkAllDirectoriesPending = true;
+    return;
+  }
+
+  m_pendingChangedDirectories.clear();
+  m_sourceIndexUpdater->start(m_rootDirectoryName, m_sourceIndex.directoriesLastModified());
+}
+
+void SourcesAndOpenFiles::endIndexUpdate(int p_filesCount) {
+  Q_UNUSED(p_filesCount)
+
+  if (m_checkAllDirectoriesPending) {
+    m_checkAllDirectoriesPending = false;
+    checkAllDirectories();
+  } else if (!m_pendingChangedDirectories.isEmpty()) {
+    updateChangedDirectories(QStringList());
+  } else {
+    if (m_treeFilterAction->isChecked()) {
+      filterTreeView(m_searchLineEdit->text());
+    }
+
+    // Only the files of the update are parsed again, the snapshot and the content index are
+    // brought up to date at most once per delay however often the tree changes
+    m_symbolIndexer->update(m_changedSourceFilePaths, m_removedSourceFilePaths);
+    m_changedSourceFilePaths.clear();
+    m_removedSourceFilePaths.clear();
+    if (!m_indexUpdateSaveTimer.isActive()) {
+      m_indexUpdateSaveTimer.start();
+    }
+  }
+}
+
+void SourcesAndOpenFiles::updateSymbolIndex(SymbolIndex const& p_symbolIndex) {
+  m_symbolIndex = p_symbolIndex;
+}
+
+void SourcesAndOpenFiles::saveIndexUpdates() {
+  saveSourceIndexSnapshot();
+  m_grepResultsModel->updateContentIndex();
+}
+
+void SourcesAndOpenFiles::showSearchLatency() {
+  // Keystroke to results latencies, kept at hand to track them
+  SourceSearchModel::SearchLatency latency = m_sourceSearchModel->searchLatency();
+  m_searchLineEdit->setToolTip(QString("Last search: %1 ms, average: %2 ms, slowest: %3 ms over %4 searches").arg(latency.last).arg(latency.total/latency.count).arg(latency.maximum).arg(latency.count));
 }
 
 
 /// Private
 
-void SourcesAndOpenFiles::fillSourceModelFromSettingsDirectory(QString const& p_directoryName) {
-  QDir directory(p_directoryName);
-  QStringList subDirectories = directory.entryList(QDir::AllDirs | QDir::NoDotAndDotDot);
-  QStringList sourceCodeFiles = directory.entryList(QStringList() << "*.cpp" << "*.h", QDir::Files);
+void SourcesAndOpenFiles::filterTreeView(QString const& p_pattern) {
+  QRegExp::PatternSyntax patternSyntax = m_regExpSearchAction->isChecked() ? QRegExp::RegExp : QRegExp::FixedString;
+  m_sourceTreeProxyModel->setTreeFilter(m_sourceIndex, p_pattern, patternSyntax);
 
-  for (QString const& sourceCodeFile: sourceCodeFiles) {
-    m_sourceSearchModel->insertDocument(sourceCodeFile, p_directoryName+QDir::separator()+sourceCodeFile);
+  // A few matches are shown right away
+  SourceTreeFilter const& treeFilter = m_sourceTreeProxyModel->treeFilter();
+  if (!treeFilter.isActive() || treeFilter.matchedFileCount() > g_maximumExpandedDirectoryCount) {
+    return;
+  }
+  QStringList matchedDirectories = treeFilter.matchedDirectories();
+  if (matchedDirectories.size() <= g_maximumExpandedDirectoryCount) {
+    for (QString const& directoryPath: matchedDirectories) {
+      m_sourcesTreeView->expand(m_sourceTreeProxyModel->mapFromSource(m_sourceModel->index(directoryPath)));
+    }
   }
+}
+
+void SourcesAndOpenFiles::watchIndexedDirectories(QVector<IndexedDirectory> const& p_directories) {
+  for (IndexedDirectory const& directory: p_directories) {
+    m_sourceIndexWatcher->watchDirectory(directory.absolutePath);
+  }
+}
 
-  for (QString const& subDirectory: subDirectories) {
-    fillSourceModelFromSettingsDirectory(p_directoryName+QDir::separator()+subDirectory);
+void SourcesAndOpenFiles::saveSourceIndexSnapshot() {
+  if (m_sourceIndexModified && !m_sourceIndexer->isRunning() && !m_sourceIndexUpdater->isRunning()) {
+    // Searchers keep the directory ids of the live index, only the saved copy is renumbered
+    SourceIndex compactedIndex = m_sourceIndex;
+    compactedIndex.compactDirectories();
+    SourceIndexSnapshot::save(SourceIndexSnapshot::defaultFileName(), compactedIndex);
+    m_sourceIndexModified = false;
   }
 }
@@ -8,12 +8,21 @@
 #include <QSortFilterProxyModel>
 #include <QTreeView>
 #include <QLineEdit>
+#include <QTimer>
 
 #include "ui_SourcesAndOpenFiles.h"
 
 #include "SourceFileSystemModel.hxx"
 #include "SourceFileSystemProxyModel.hxx"
 #include "OpenDocumentsModel.hxx"
+#include "SourceIndexer.hxx"
+#include "SourceIndex.hxx"
+#include "SourceIndexWatcher.hxx"
+#include "SourceSearchModel.hxx"
+#include "SourceSearchItemDelegate.hxx"
+#include "GrepResultsModel.hxx"
+#include "SymbolIndex.hxx"
+#include "SymbolIndexer.hxx"
 
 class SourcesAndOpenFiles: public QWidget, protected Ui::SourcesAndOpenFiles {
   Q_OBJECT
@@ -29,6 +38,8 @@ public:
   void insertDocument(QString const& p_fileName, QString const& p_absoluteFilePath);
   void removeOpenDocument(QString const& p_absoluteFilePath);
   void clearOpenDocument();
+  /// Most relevant definition of a class, enum or function, false until symbols are indexed
+  bool findSymbolDefinition(QString const& p_symbol, QString& p_absoluteFilePath, int& p_lineNumber) const;
 
 public slots:
   void addOrRemoveStarToOpenDocument(QString const& p_fileName, QString const& p_absoluteFilePath, bool p_add);
@@ -36,24 +47,61 @@ public slots:
 
 protected slots:
   void searchFiles(QString const& p_fileName);
+  void setRegExpSearch(bool p_regExpSearch);
+  void setTreeFilterMode(bool p_treeFilterMode);
+  void setGrepMode(bool p_grepMode);
+  void openSourceCodeFromTreeView(QModelIndex const& p_index);
   void sortOpenDocuments(QModelIndex, int, int);
   void destroyContextualMenu(QObject* p_object);
   void openSourceCodeFromMenu();
   void expandTreeView(QModelIndex const& p_index);
+  void insertIndexedDirectories(QVector<IndexedDirectory> const& p_directories);
+  void removeIndexedDirectories(QStringList const& p_absolutePaths);
+  void updateIndexingProgress(int p_filesCount, int p_directoriesCount);
+  void endIndexing(int p_filesCount);
+  void updateChangedDirectories(QStringList const& p_absolutePaths);
+  void checkAllDirectories();
+  void endIndexUpdate(int p_filesCount);
+  void updateSymbolIndex(SymbolIndex const& p_symbolIndex);
+  void saveIndexUpdates();
+  void showSearchLatency();
 
 signals:
   void openSourceCodeFromTreeViewRequested(QModelIndex);
   void openSourceCodeFromSearchRequested(QModelIndex);
   void openSourceCodeFromOpenDocumentsRequested(QModelIndex);
   void openSourceCodeFromContextualMenuRequested(QModelIndex);
+  void openSourceCodeFromGrepRequested(QModelIndex);
 
 private:
-  void fillSourceModelFromSettingsDirectory(QString const& p_directoryName);
-
   SourceFileSystemModel* m_sourceModel;
-
-  OpenDocumentsModel* m_sourceSearchModel;
-  SourceFileSystemProxyModel* m_sourceFileSystemProxyModel;
+  SourceFileSystemProxyModel* m_sourceTreeProxyModel;
+  void filterTreeView(QString const& p_pattern);
+  void watchIndexedDirectories(QVector<IndexedDirectory> const& p_directories);
+  void saveSourceIndexSnapshot();
+
+  SourceIndexer* m_sourceIndexer;
+  SourceIndexer* m_sourceIndexUpdater;
+  SourceIndexWatcher* m_sourceIndexWatcher;
+  SourceIndex m_sourceIndex;
+  bool m_sourceIndexModified;
+  QSet<QString> m_pendingChangedDirectories;
+  bool m_checkAllDirectoriesPending;
+  /// Files added, modified or removed by the watched changes, for the symbol index
+  QStringList m_changedSourceFilePaths;
+  QStringList m_removedSourceFilePaths;
+  QTimer m_indexUpdateSaveTimer;
+
+  SourceSearchModel* m_sourceSearchModel;
+  QAction* m_regExpSearchAction;
+  QAction* m_treeFilterAction;
+
+  GrepResultsModel* m_grepResultsModel;
+  QListView* m_grepResultsView;
+  QAction* m_grepAction;
+
+  SymbolIndexer* m_symbolIndexer;
+  SymbolIndex m_symbolIndex;
 
   OpenDocumentsModel* m_openDocumentsModel;
   QSortFilterProxyModel* m_openDocumentsSortFilterProxyModel;
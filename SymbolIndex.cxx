@@ -0,0 +1,198 @@
+#include "SymbolIndex.hxx"
+
+#include <QFile>
+#include <QVector>
+
+#include <cstring>
+
+#include "FileTypes.hxx"
+#include "CppDeclarationParser.hxx"
+
+namespace {
+  qint64 const g_maximumFileSize = 8*1024*1024;
+  qint64 const g_binaryCheckLength = 1024;
+
+  struct ParsedSymbol {
+    QString name;
+    int offset;
+    int lineNumber;
+    SymbolIndex::SymbolKind kind;
+  };
+
+  /// Keeps the definitions of a file, methods defined out of their class under their qualified name too
+  class SymbolCollector {
+  public:
+    explicit SymbolCollector(char const* p_data):
+      m_data(p_data),
+      m_symbols() {
+    }
+
+    QVector<ParsedSymbol> const& symbols() const { return m_symbols; }
+
+    void declarationFound(CppDeclaration const& p_declaration) {
+      if (!p_declaration.definition) {
+        return;
+      }
+
+      ParsedSymbol symbol;
+      symbol.name = QString::fromUtf8(m_data+p_declaration.nameStart, p_declaration.nameLength);
+      symbol.offset = p_declaration.nameStart;
+      symbol.lineNumber = p_declaration.lineNumber;
+      // Declaration kinds are in the order of symbol kinds
+      symbol.kind = SymbolIndex::SymbolKind(p_declaration.kind);
+      m_symbols << symbol;
+
+      if (p_declaration.qualifierLength > 0) {
+        symbol.name = QString::fromUtf8(m_data+p_declaration.qualifierStart, p_declaration.qualifierLength)+"::"+symbol.name;
+        m_symbols << symbol;
+      }
+    }
+
+  private:
+    char const* m_data;
+    QVector<ParsedSymbol> m_symbols;
+  };
+}
+
+SymbolIndex::SymbolIndex():
+  m_filePaths(),
+  m_fileIds(),
+  m_definitions() {
+}
+
+/// Public
+
+bool SymbolIndex::findDefinition(QString const& p_symbol, Definition& p_definition) const {
+  auto definition = m_definitions.constFind(p_symbol);
+  if (definition == m_definitions.constEnd()) {
+    return false;
+  }
+  for (auto otherDefinition = definition+1; otherDefinition != m_definitions.constEnd() && otherDefinition.key() == p_symbol; ++otherDefinition) {
+    if (precedes(otherDefinition.value(), definition.value())) {
+      definition = otherDefinition;
+    }
+  }
+
+  p_definition.absoluteFilePath = m_filePaths.at(definition->fileId);
+  p_definition.offset = definition->offset;
+  p_definition.lineNumber = definition->lineNumber;
+  p_definition.kind = SymbolKind(definition->kind);
+  return true;
+}
+
+bool SymbolIndex::parseFile(QString const& p_absoluteFilePath) {
+  QFile file(p_absoluteFilePath);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  qint64 size = file.size();
+  if (size == 0 || size > g_maximumFileSize) {
+    return true;
+  }
+
+  QByteArray content;
+  char const* data = reinterpret_cast<char const*>(file.map(0, size));
+  if (data == nullptr) {
+    content = file.readAll();
+    data = content.constData();
+    size = content.size();
+  }
+  if (std::memchr(data, '\0', qMin(size, g_binaryCheckLength)) != nullptr) {
+    return true;
+  }
+
+  SymbolCollector collector(data);
+  CppDeclarationParser<char, SymbolCollector>(data, int(size), collector).parse();
+  QVector<ParsedSymbol> const& symbols = collector.symbols();
+  if (symbols.isEmpty()) {
+    return true;
+  }
+
+  int parsedFileId = fileId(p_absoluteFilePath);
+  for (ParsedSymbol const& symbol: symbols) {
+    FileDefinition definition;
+    definition.fileId = parsedFileId;
+    definition.offset = symbol.offset;
+    definition.lineNumber = symbol.lineNumber;
+    definition.kind = symbol.kind;
+    definition.rank = definitionRank(p_absoluteFilePath, symbol.kind);
+    m_definitions.insert(symbol.name, definition);
+  }
+  return true;
+}
+
+void SymbolIndex::merge(SymbolIndex const& p_symbolIndex) {
+  QVector<int> fileIds;
+  fileIds.reserve(p_symbolIndex.m_filePaths.size());
+  for (QString const& absoluteFilePath: p_symbolIndex.m_filePaths) {
+    fileIds << fileId(absoluteFilePath);
+  }
+
+  m_definitions.reserve(m_definitions.size()+p_symbolIndex.m_definitions.size());
+  for (auto definition = p_symbolIndex.m_definitions.constBegin(); definition != p_symbolIndex.m_definitions.constEnd(); ++definition) {
+    FileDefinition fileDefinition = definition.value();
+    fileDefinition.fileId = fileIds.at(fileDefinition.fileId);
+    m_definitions.insert(definition.key(), fileDefinition);
+  }
+}
+
+void SymbolIndex::removeFiles(QStringList const& p_absoluteFilePaths) {
+  QVector<bool> removedFiles(m_filePaths.size(), false);
+  bool removed = false;
+  for (QString const& absoluteFilePath: p_absoluteFilePaths) {
+    int removedFileId = m_fileIds.value(absoluteFilePath, -1);
+    if (removedFileId >= 0) {
+      removedFiles[removedFileId] = true;
+      removed = true;
+    }
+  }
+  if (!removed) {
+    return;
+  }
+
+  // A single pass over the definitions for the whole batch
+  for (auto definition = m_definitions.begin(); definition != m_definitions.end(); ) {
+    if (removedFiles.at(definition->fileId)) {
+      definition = m_definitions.erase(definition);
+    } else {
+      ++definition;
+    }
+  }
+}
+
+
+/// Private
+
+int SymbolIndex::fileId(QString const& p_absoluteFilePath) {
+  auto fileId = m_fileIds.constFind(p_absoluteFilePath);
+  if (fileId != m_fileIds.constEnd()) {
+    return fileId.value();
+  }
+
+  m_filePaths << p_absoluteFilePath;
+  m_fileIds.insert(p_absoluteFilePath, m_filePaths.size()-1);
+  return m_filePaths.size()-1;
+}
+
+bool SymbolIndex::precedes(FileDefinition const& p_definition, FileDefinition const& p_otherDefinition) const {
+  // Files are parsed in any order, ties are broken by path then position for the same definition to win every time
+  if (p_definition.rank != p_otherDefinition.rank) {
+    return p_definition.rank < p_otherDefinition.rank;
+  }
+  if (p_definition.fileId != p_otherDefinition.fileId) {
+    return m_filePaths.at(p_definition.fileId) < m_filePaths.at(p_otherDefinition.fileId);
+  }
+  return p_definition.offset < p_otherDefinition.offset;
+}
+
+quint8 SymbolIndex::definitionRank(QString const& p_absoluteFilePath, SymbolKind p_kind) {
+  // Types before functions, library code before tests and examples, types from headers and functions from sources
+  quint8 rank = quint8(p_kind)*4;
+  if (p_absoluteFilePath.contains("/tests/") || p_absoluteFilePath.contains("/examples/") || p_absoluteFilePath.contains("/3rdparty/")) {
+    rank += 2;
+  }
+  if ((p_kind == eFunctionSymbol) == FileTypes::isHeader(FileTypes::fileType(p_absoluteFilePath))) {
+    rank += 1;
+  }
+  return rank;
+}
@@ -0,0 +1,66 @@
+#ifndef SYMBOLINDEX_HXX
+#define SYMBOLINDEX_HXX
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMultiHash>
+#include <QMetaType>
+
+/// Definitions of the classes, enums and functions of the source tree, found
+/// by a light parse of the C and C++ files: comments, literals, preprocessor
+/// lines and function bodies are skipped, and only the braces that open a
+/// definition at namespace or class scope are looked at.
+///
+/// Every definition of a symbol is kept, so that the definitions of a file can
+/// be dropped when it changes, and finding a symbol picks the most relevant of
+/// its few definitions. Methods defined out of their class are also kept under
+/// their qualified name.
+class SymbolIndex {
+public:
+  enum SymbolKind {
+    eClassSymbol = 0,
+    eEnumSymbol,
+    eFunctionSymbol
+  };
+
+  struct Definition {
+    QString absoluteFilePath;
+    int offset;
+    int lineNumber;
+    SymbolKind kind;
+  };
+
+  SymbolIndex();
+
+  bool isEmpty() const { return m_definitions.isEmpty(); }
+  bool findDefinition(QString const& p_symbol, Definition& p_definition) const;
+
+  /// Adds the definitions of a file, returns false if it cannot be read
+  bool parseFile(QString const& p_absoluteFilePath);
+  void merge(SymbolIndex const& p_symbolIndex);
+  /// Drops the definitions of files removed or about to be parsed again
+  void removeFiles(QStringList const& p_absoluteFilePaths);
+
+private:
+  struct FileDefinition {
+    int fileId;
+    int offset;
+    int lineNumber;
+    quint8 kind;
+    quint8 rank;
+  };
+
+  int fileId(QString const& p_absoluteFilePath);
+  bool precedes(FileDefinition const& p_definition, FileDefinition const& p_otherDefinition) const;
+  static quint8 definitionRank(QString const& p_absoluteFilePath, SymbolKind p_kind);
+
+  /// Paths of the files parsed so far, a file parsed again keeps its id
+  QStringList m_filePaths;
+  QHash<QString, int> m_fileIds;
+  QMultiHash<QString, FileDefinition> m_definitions;
+};
+
+Q_DECLARE_METATYPE(SymbolIndex)
+
+#endif // SYMBOLINDEX_HXX
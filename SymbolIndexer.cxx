@@ -0,0 +1,187 @@
+#include "SymbolIndexer.hxx"
+
+#include <QRunnable>
+#include <QThread>
+#include <QMutex>
+#include <QSharedPointer>
+
+namespace {
+  int const g_filesPerChunk = 64;
+
+  /// Parses every file of the source index, or the given files only into the index to update
+  struct SymbolIndexerJob {
+    SourceIndex sourceIndex;
+    QStringList filePaths;
+    bool update;
+    int generation;
+    QAtomicInt nextFileId;
+    QAtomicInt runningWorkerCount;
+    QMutex symbolIndexMutex;
+    SymbolIndex symbolIndex;
+  };
+}
+
+class SymbolIndexerWorker: public QRunnable {
+public:
+  SymbolIndexerWorker(SymbolIndexer* p_indexer, QSharedPointer<SymbolIndexerJob> const& p_job):
+    QRunnable(),
+    m_indexer(p_indexer),
+    m_job(p_job) {
+
+    setAutoDelete(true);
+  }
+
+  void run() override {
+    // Definitions are gathered apart and merged once, workers do not wait on each other
+    SymbolIndex symbolIndex;
+    int fileCount = m_job->update ? m_job->filePaths.size() : m_job->sourceIndex.fileCount();
+    while (isCurrent()) {
+      int firstFileId = m_job->nextFileId.fetchAndAddRelaxed(g_filesPerChunk);
+      if (firstFileId >= fileCount) {
+        break;
+      }
+
+      int lastFileId = qMin(firstFileId+g_filesPerChunk, fileCount);
+      for (int fileId = firstFileId; fileId < lastFileId; ++fileId) {
+        if (m_job->update) {
+          QString const& absoluteFilePath = m_job->filePaths.at(fileId);
+          if (FileTypes::isCppCode(FileTypes::fileType(absoluteFilePath))) {
+            symbolIndex.parseFile(absoluteFilePath);
+          }
+        } else if (FileTypes::isCppCode(m_job->sourceIndex.fileType(fileId))) {
+          symbolIndex.parseFile(m_job->sourceIndex.absoluteFilePath(fileId));
+        }
+      }
+    }
+
+    if (isCurrent()) {
+      QMutexLocker locker(&m_job->symbolIndexMutex);
+      m_job->symbolIndex.merge(symbolIndex);
+    }
+
+    // The last worker to leave reports the index
+    if (m_job->runningWorkerCount.fetchAndAddOrdered(-1) == 1 && isCurrent()) {
+      emit m_indexer->jobFinished(m_job->generation, m_job->symbolIndex);
+    }
+  }
+
+private:
+  bool isCurrent() const {
+    return m_indexer->m_generation.load() == m_job->generation;
+  }
+
+  SymbolIndexer* m_indexer;
+  QSharedPointer<SymbolIndexerJob> m_job;
+};
+
+
+SymbolIndexer::SymbolIndexer(QObject* p_parent):
+  QObject(p_parent),
+  m_threadPool(),
+  m_generation(0),
+  m_running(false),
+  m_started(false),
+  m_symbolIndex(),
+  m_changedFilePaths(),
+  m_removedFilePaths() {
+
+  m_threadPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+
+  qRegisterMetaType<SymbolIndex>("SymbolIndex");
+  connect(this, SIGNAL(jobFinished(int,SymbolIndex)), this, SLOT(storeSymbolIndex(int,SymbolIndex)), Qt::QueuedConnection);
+}
+
+SymbolIndexer::~SymbolIndexer() {
+  cancel();
+  m_threadPool.waitForDone();
+}
+
+/// Public
+
+void SymbolIndexer::start(SourceIndex const& p_sourceIndex) {
+  int generation = m_generation.fetchAndAddOrdered(1)+1;
+  m_threadPool.clear();
+
+  // The whole tree is parsed, changes known so far are part of it
+  m_changedFilePaths.clear();
+  m_removedFilePaths.clear();
+  m_running = true;
+  m_started = true;
+
+  QSharedPointer<SymbolIndexerJob> job(new SymbolIndexerJob);
+  job->sourceIndex = p_sourceIndex;
+  job->update = false;
+  job->generation = generation;
+
+  int workerCount = m_threadPool.maxThreadCount();
+  job->runningWorkerCount.store(workerCount);
+  for (int k = 0; k < workerCount; ++k) {
+    m_threadPool.start(new SymbolIndexerWorker(this, job));
+  }
+}
+
+void SymbolIndexer::update(QStringList const& p_changedFilePaths, QStringList const& p_removedFilePaths) {
+  for (QString const& absoluteFilePath: p_changedFilePaths) {
+    m_changedFilePaths.insert(absoluteFilePath);
+    m_removedFilePaths.remove(absoluteFilePath);
+  }
+  for (QString const& absoluteFilePath: p_removedFilePaths) {
+    m_removedFilePaths.insert(absoluteFilePath);
+    m_changedFilePaths.remove(absoluteFilePath);
+  }
+
+  // Before the first build, changes are part of it
+  if (m_started && !m_running) {
+    startUpdate();
+  }
+}
+
+void SymbolIndexer::cancel() {
+  m_generation.fetchAndAddOrdered(1);
+  m_threadPool.clear();
+  m_running = false;
+}
+
+
+/// Private slots
+
+void SymbolIndexer::storeSymbolIndex(int p_generation, SymbolIndex const& p_symbolIndex) {
+  if (p_generation != m_generation.load()) {
+    return;
+  }
+
+  m_running = false;
+  m_symbolIndex = p_symbolIndex;
+  emit symbolsIndexed(m_symbolIndex);
+
+  // Changes received meanwhile
+  startUpdate();
+}
+
+
+/// Private
+
+void SymbolIndexer::startUpdate() {
+  if (m_changedFilePaths.isEmpty() && m_removedFilePaths.isEmpty()) {
+    return;
+  }
+
+  int generation = m_generation.fetchAndAddOrdered(1)+1;
+  m_running = true;
+
+  // Workers merge the files parsed again into the last index, without their former definitions
+  QSharedPointer<SymbolIndexerJob> job(new SymbolIndexerJob);
+  job->filePaths = m_changedFilePaths.toList();
+  job->update = true;
+  job->generation = generation;
+  job->symbolIndex = m_symbolIndex;
+  job->symbolIndex.removeFiles(job->filePaths+m_removedFilePaths.toList());
+  m_changedFilePaths.clear();
+  m_removedFilePaths.clear();
+
+  int workerCount = qMin(m_threadPool.maxThreadCount(), job->filePaths.size()/g_filesPerChunk+1);
+  job->runningWorkerCount.store(workerCount);
+  for (int k = 0; k < workerCount; ++k) {
+    m_threadPool.start(new SymbolIndexerWorker(this, job));
+  }
+}
@@ -0,0 +1,54 @@
+#ifndef SYMBOLINDEXER_HXX
+#define SYMBOLINDEXER_HXX
+
+#include <QObject>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QSet>
+
+#include "SourceIndex.hxx"
+#include "SymbolIndex.hxx"
+
+/// Builds the symbol index of a copy of the source index. The C and C++ files
+/// are parsed by chunks on every core, each worker merging its definitions
+/// once done. Starting a new build cancels the previous one.
+///
+/// Files changed afterwards are parsed again on their own. Their changes wait
+/// for the build or update under way to end instead of cancelling it, so that
+/// a steady stream of changes cannot keep the index from being completed.
+class SymbolIndexer: public QObject {
+  Q_OBJECT
+
+  friend class SymbolIndexerWorker;
+
+public:
+  explicit SymbolIndexer(QObject* p_parent = nullptr);
+  ~SymbolIndexer();
+
+  void start(SourceIndex const& p_sourceIndex);
+  /// Parses again files added or modified and drops the removed ones, once the index is built
+  void update(QStringList const& p_changedFilePaths, QStringList const& p_removedFilePaths);
+  void cancel();
+
+signals:
+  void symbolsIndexed(SymbolIndex p_symbolIndex);
+  void jobFinished(int p_generation, SymbolIndex p_symbolIndex);
+
+private slots:
+  void storeSymbolIndex(int p_generation, SymbolIndex const& p_symbolIndex);
+
+private:
+  void startUpdate();
+
+  QThreadPool m_threadPool;
+  QAtomicInt m_generation;
+  bool m_running;
+  bool m_started;
+
+  /// Last index built, the base of the next update
+  SymbolIndex m_symbolIndex;
+  QSet<QString> m_changedFilePaths;
+  QSet<QString> m_removedFilePaths;
+};
+
+#endif // SYMBOLINDEXER_HXX